@@ -6,8 +6,14 @@
 
 #include "Algorithms.h"
 
-#include <unordered_set>
+#include <array>
+#include <cmath>
+#include <cstring>
 #include <execution>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <optional>
 
 #include "vorbrodt/pool.hpp"
 
@@ -56,79 +62,105 @@ std::size_t SelectCombination::RunSingleThread(std::size_t numElelment, std::siz
     return numCombs;
 }
 
-std::size_t SelectCombination::RunMultiThread(std::size_t numElelment, std::size_t numSelect,
-    std::function<void(const std::vector<std::size_t>&, std::size_t)> callBack)
+void SelectCombination::UnrankCombination(std::size_t numElelment, std::size_t numSelect,
+    std::size_t indexOfComb, std::vector<std::size_t>& outComb)
 {
-    std::vector<std::size_t> inputIndices(numElelment);
-    for (std::size_t i = 0; i < numElelment; ++i)
-        inputIndices[i] = i;
+    assert(indexOfComb < GetNumOfSelectionComb(numElelment, numSelect));
 
-    // Compute num per thread envoke
-    const auto totalNumCombs = GetNumOfSelectionComb(numElelment, numSelect);
-    auto hardWareThreads     = std::thread::hardware_concurrency();
-    auto numPerThread        = totalNumCombs / hardWareThreads;
-    if (numPerThread == 0)
-        numPerThread = totalNumCombs;
+    outComb.resize(numSelect);
 
-    std::size_t numCombs = 0;
+    // Combinatorial number system, pick the smallest element of each position whose number of
+    // following combinations covers the remaining index.
+    std::size_t element = 0;
+    for (std::size_t i = 0; i < numSelect; ++i)
     {
+        while (true)
+        {
+            auto numCombsStartWith =
+                GetNumOfSelectionComb(numElelment - element - 1, numSelect - i - 1);
+            if (indexOfComb < numCombsStartWith)
+                break;
+
+            indexOfComb -= numCombsStartWith;
+            ++element;
+        }
+        outComb[i] = element++;
+    }
+}
 
-        std::vector<std::size_t> stack(numSelect);
-        const std::size_t kEnd = numElelment - numSelect;
+bool SelectCombination::NextCombination(std::size_t numElelment, std::vector<std::size_t>& comb)
+{
+    const auto numSelect = comb.size();
 
-        struct Args
+    // Find the right most element which can still be increased.
+    auto i = numSelect;
+    while (i > 0)
+    {
+        --i;
+        if (comb[i] < numElelment - numSelect + i)
         {
-            Args(const std::vector<std::size_t>& stack, std::size_t stackIndex) :
-                stack(stack), stackIndex(stackIndex)
-            {
-            }
-            std::vector<std::size_t> stack;
-            std::size_t stackIndex = 0;
-        };
-        std::vector<Args> taskVecStack;
-        std::vector<std::thread> threadVec;
-        auto combRecursion = LambdaCombinator(
-            [&](auto& selfLambda, std::size_t offset, std::size_t stackIndex) -> void {
-                if (stackIndex == numSelect)
-                {
-                    if (callBack)
-                    {
-                        if (taskVecStack.size() == numPerThread)
-                        {
-                            // When stack size reached expected numPerThread, we move the stack to
-                            // the task lambda.
-                            threadVec.emplace_back([&, vec = std::move(taskVecStack)]() {
-                                for (auto& arg : vec)
-                                {
-                                    callBack(arg.stack, arg.stackIndex);
-                                }
-                            });
-                        }
+            ++comb[i];
+            for (auto j = i + 1; j < numSelect; ++j)
+                comb[j] = comb[j - 1] + 1;
+            return true;
+        }
+    }
 
-                        taskVecStack.emplace_back(stack, numCombs);
-                    }
-                    ++numCombs;
-                    return;
-                }
+    return false;
+}
 
-                auto endIndex = kEnd + stackIndex;
-                for (std::size_t i = offset; i <= endIndex; ++i)
-                {
-                    stack[stackIndex] = inputIndices[i];
-                    selfLambda(i + 1, stackIndex + 1);
-                }
-            });
+namespace
+{
+// Enumerate combinations in range of [beginIndex, endIndex) in lexicographic order, the comb
+// stack is reused and no combination is materialized.
+template <typename TypeCallBack>
+void RunCombinationRange(std::size_t numElelment, std::size_t numSelect, std::size_t beginIndex,
+    std::size_t endIndex, std::vector<std::size_t>& stack, TypeCallBack&& callBack)
+{
+    if (beginIndex >= endIndex)
+        return;
+
+    SelectCombination::UnrankCombination(numElelment, numSelect, beginIndex, stack);
+    for (auto indexOfComb = beginIndex; indexOfComb < endIndex; ++indexOfComb)
+    {
+        callBack(stack, indexOfComb);
+        SelectCombination::NextCombination(numElelment, stack);
+    }
+}
+} // namespace
+
+std::size_t SelectCombination::RunMultiThread(std::size_t numElelment, std::size_t numSelect,
+    std::function<void(const std::vector<std::size_t>&, std::size_t)> callBack)
+{
+    // Compute num per thread envoke
+    const auto totalNumCombs = GetNumOfSelectionComb(numElelment, numSelect);
+    if (totalNumCombs == 0)
+        return 0;
 
-        combRecursion(0, 0);
+    const std::size_t numThreads = std::min<std::size_t>(GetNumParallelWorkers(), totalNumCombs);
+    const auto numPerThread      = (totalNumCombs + numThreads - 1) / numThreads;
 
-        // if the stack is not empty, that means we have talling combs.
-        if (!taskVecStack.empty())
+    // Each thread starts from its own index of combs, so that the memory is O(numThreads *
+    // numSelect) regardless of the number of combs.
+    std::atomic<std::size_t> numCombs = 0;
+    {
+        std::vector<std::thread> threadVec;
+        threadVec.reserve(numThreads);
+        for (std::size_t i = 0; i < numThreads; ++i)
         {
-            threadVec.emplace_back([&, vec = std::move(taskVecStack)]() {
-                for (auto& arg : vec)
-                {
-                    callBack(arg.stack, arg.stackIndex);
-                }
+            auto beginIndex = std::min(i * numPerThread, totalNumCombs);
+            auto endIndex   = std::min(beginIndex + numPerThread, totalNumCombs);
+
+            threadVec.emplace_back([&, beginIndex, endIndex]() {
+                std::vector<std::size_t> stack(numSelect);
+                RunCombinationRange(numElelment, numSelect, beginIndex, endIndex, stack,
+                    [&](const std::vector<std::size_t>& comb, std::size_t indexOfComb) {
+                        if (callBack)
+                        {
+                            callBack(comb, indexOfComb);
+                        }
+                    });
+                numCombs += endIndex - beginIndex;
             });
         }
 
@@ -148,6 +180,204 @@ std::size_t SelectCombination::RunMultiThread(std::size_t numElelment, std::size
     return numCombs;
 }
 
+std::uint32_t SelectCombination::GetNumParallelWorkers()
+{
+    auto hardWareThreads = std::thread::hardware_concurrency();
+    return hardWareThreads == 0 ? 1 : hardWareThreads;
+}
+
+std::size_t SelectCombination::RunParallel(std::size_t numElelment, std::size_t numSelect,
+    std::function<void(const std::vector<std::size_t>&, std::size_t, std::uint32_t)> callBack)
+{
+    const auto totalNumCombs = GetNumOfSelectionComb(numElelment, numSelect);
+    if (totalNumCombs == 0)
+        return 0;
+
+    // Comb stack of each worker
+    std::vector<std::vector<std::size_t>> stackVec(
+        GetNumParallelWorkers(), std::vector<std::size_t>(numSelect));
+
+    std::atomic<std::size_t> numCombs = 0;
+    RunParallelSlices(totalNumCombs,
+        [&](std::size_t beginIndex, std::size_t endIndex, std::uint32_t workerIndex) {
+            RunCombinationRange(numElelment, numSelect, beginIndex, endIndex,
+                stackVec[workerIndex],
+                [&](const std::vector<std::size_t>& comb, std::size_t indexOfComb) {
+                    if (callBack)
+                    {
+                        callBack(comb, indexOfComb, workerIndex);
+                    }
+                });
+            numCombs += endIndex - beginIndex;
+        });
+
+#ifdef M_DEBUG
+    {
+        if (totalNumCombs != numCombs)
+        {
+            assert(false);
+            throw std::runtime_error(" Result of SelectCombination is not correct! \n");
+            return 0;
+        }
+    }
+#endif // M_DEBUG
+    return numCombs;
+}
+
+void SelectCombination::RunParallelSlices(std::size_t numTotal,
+    std::function<void(std::size_t, std::size_t, std::uint32_t)> sliceCallBack)
+{
+    if (numTotal == 0)
+        return;
+
+    const auto numWorkers = GetNumParallelWorkers();
+
+    // Workers keep fetching slices until all of them are consumed, which balances the workload
+    // between workers.
+    static constexpr std::size_t kNumSlicesPerWorker = 8;
+    const auto numSlices   = std::min<std::size_t>(numWorkers * kNumSlicesPerWorker, numTotal);
+    const auto numPerSlice = (numTotal + numSlices - 1) / numSlices;
+
+    std::atomic<std::size_t> nextSliceIndex = 0;
+    auto workerFunc                         = [&](std::uint32_t workerIndex) -> void {
+        std::size_t sliceIndex = 0;
+        while ((sliceIndex = nextSliceIndex++) < numSlices)
+        {
+            auto beginIndex = std::min(sliceIndex * numPerSlice, numTotal);
+            auto endIndex   = std::min(beginIndex + numPerSlice, numTotal);
+            if (beginIndex < endIndex)
+                sliceCallBack(beginIndex, endIndex, workerIndex);
+        }
+    };
+
+    std::vector<std::thread> threadVec;
+    threadVec.reserve(numWorkers);
+    for (std::uint32_t i = 0; i < numWorkers; ++i)
+        threadVec.emplace_back(workerFunc, i);
+
+    for (auto& thread : threadVec)
+        thread.join();
+}
+
+std::uint64_t SelectCombination::UnrankBitMaskComb(
+    std::size_t numElelment, std::size_t numSelect, std::size_t indexOfComb)
+{
+    assert(numElelment <= PickIndex::k_maxInputSize);
+    assert(indexOfComb < GetNumOfSelectionComb(numElelment, numSelect));
+
+    // Combinatorial number system of colexicographic order, from the highest selected bit, pick
+    // the highest bit whose number of combs below it does not exceed the remaining index.
+    std::uint64_t mask = 0;
+    auto bit           = numElelment;
+    for (auto i = numSelect; i > 0; --i)
+    {
+        do
+        {
+            --bit;
+        } while (GetNumOfSelectionComb(bit, i) > indexOfComb);
+
+        indexOfComb -= GetNumOfSelectionComb(bit, i);
+        mask |= PickIndex::k_inputIndexBitMask[bit];
+    }
+
+    return mask;
+}
+
+void SelectCombination::UnrankRevolvingDoorComb(std::size_t numElelment, std::size_t numSelect,
+    std::size_t indexOfComb, std::vector<std::size_t>& outComb)
+{
+    assert(indexOfComb < GetNumOfSelectionComb(numElelment, numSelect));
+
+    outComb.resize(numSelect);
+
+    // Walk down the recursive definition, the combs containing the last element are in reversed
+    // order so that the index is mirrored.
+    auto numLeft = numSelect;
+    while (numLeft > 0)
+    {
+        if (numLeft == numElelment)
+        {
+            for (std::size_t i = 0; i < numLeft; ++i)
+                outComb[i] = i;
+            break;
+        }
+
+        auto numCombsWithoutLast = GetNumOfSelectionComb(numElelment - 1, numLeft);
+        if (indexOfComb >= numCombsWithoutLast)
+        {
+            indexOfComb = GetNumOfSelectionComb(numElelment - 1, numLeft - 1) - 1 -
+                (indexOfComb - numCombsWithoutLast);
+            outComb[--numLeft] = numElelment - 1;
+        }
+        --numElelment;
+    }
+}
+
+bool SelectCombination::NextRevolvingDoorComb(std::size_t numElelment,
+    std::vector<std::size_t>& comb, std::size_t& outRemoved, std::size_t& outAdded)
+{
+    // Indices below follow Algorithm R, c[1] to c[t] are comb[0] to comb[t - 1] and c[t + 1] is
+    // numElelment.
+    const auto t = comb.size();
+    if (t == 0 || t == numElelment)
+        return false;
+
+    auto c = [&](std::size_t j) -> std::size_t& { return comb[j - 1]; };
+    auto cOrEnd = [&](std::size_t j) -> std::size_t { return j <= t ? comb[j - 1] : numElelment; };
+
+    std::size_t j = 2;
+    bool tryDecrease;
+    // Easy case
+    if (t & 1)
+    {
+        if (c(1) + 1 < cOrEnd(2))
+        {
+            outRemoved = c(1)++;
+            outAdded   = c(1);
+            return true;
+        }
+        tryDecrease = true;
+    }
+    else
+    {
+        if (c(1) > 0)
+        {
+            outRemoved = c(1)--;
+            outAdded   = c(1);
+            return true;
+        }
+        tryDecrease = false;
+    }
+
+    for (; j <= t; ++j, tryDecrease = !tryDecrease)
+    {
+        if (tryDecrease)
+        {
+            if (c(j) >= j)
+            {
+                outRemoved = c(j);
+                outAdded   = j - 2;
+                c(j)       = c(j - 1);
+                c(j - 1)   = j - 2;
+                return true;
+            }
+        }
+        else
+        {
+            if (c(j) + 1 < cOrEnd(j + 1))
+            {
+                outRemoved = c(j - 1);
+                outAdded   = c(j) + 1;
+                c(j - 1)   = c(j);
+                ++c(j);
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
 void SelectCombination::SelectGroupComb::Run(bool useMultiThread)
 {
     auto mainRecursion =
@@ -245,43 +475,434 @@ void SelectCombination::SelectGroupComb::Run(bool useMultiThread)
     }
 }
 
-template <bool UseHashTable>
+namespace
+{
+// Packed to 12 bytes, as back tracking keeps up to 2 ^ MaxCombSizeBits of them.
+#pragma pack(push, 4)
 struct TempCombination
 {
+    float remainValue = 0.0f;
+
+    // Bit flag represent the index of input vector that need to be removed
+    std::uint64_t bitFlag = 0;
 };
-template <>
-struct TempCombination<true>
+#pragma pack(pop)
+static_assert(sizeof(TempCombination) == sizeof(float) + sizeof(std::uint64_t));
+
+// Upper bound of the number of combs kept by back tracking with the hash table, which are the
+// distinct multisets of removed inputs whose sum is not greater than removableSum. Inputs are
+// rounded down to a coarse unit to be counted by dynamic programming, so that the count never
+// falls short.
+double EstimateNumOfTempCombs(const std::vector<float>& inputVec, float removableSum)
 {
-    TempCombination() {}
-    TempCombination(float remainValue, std::uint64_t bitFlag, std::size_t hash) :
-        remainValue(remainValue), bitFlag(bitFlag), hash(hash)
+    static constexpr std::size_t kNumUnits = 1024;
+    if (removableSum < 0.0f)
+        return 1.0;
+
+    // Equal inputs are counted as a group, as the same multiset of them is only kept once.
+    std::vector<float> sortedInputVec = inputVec;
+    std::sort(sortedInputVec.begin(), sortedInputVec.end());
+
+    const double unit = std::max(static_cast<double>(removableSum), 1.0) / kNumUnits;
+    std::vector<double> numSubsets(kNumUnits + 1);
+    std::vector<double> prevNumSubsets;
+    numSubsets[0] = 1.0;
+    for (std::size_t groupBegin = 0, groupEnd = 0; groupBegin < sortedInputVec.size();
+         groupBegin = groupEnd)
     {
+        while (groupEnd < sortedInputVec.size() &&
+            sortedInputVec[groupEnd] == sortedInputVec[groupBegin])
+            ++groupEnd;
+
+        const double numUnits = std::floor(sortedInputVec[groupBegin] / unit);
+        if (numUnits > kNumUnits)
+            continue;
+
+        // Remove 1 up to all of the inputs in the group.
+        const auto inputUnits = static_cast<std::size_t>(numUnits);
+        prevNumSubsets        = numSubsets;
+        for (std::size_t numRemoved = 1; numRemoved <= groupEnd - groupBegin; ++numRemoved)
+        {
+            const auto removedUnits = numRemoved * inputUnits;
+            if (removedUnits > kNumUnits)
+                break;
+
+            for (std::size_t sumUnits = removedUnits; sumUnits <= kNumUnits; ++sumUnits)
+                numSubsets[sumUnits] += prevNumSubsets[sumUnits - removedUnits];
+        }
     }
 
-    float remainValue = 0.0f;
+    double out = 0.0;
+    for (const auto num : numSubsets)
+        out += num;
+    return out;
+}
 
-    // Bit flag represent the index of input vector that need to be removed
-    std::uint64_t bitFlag = 0;
-    std::size_t hash      = 0;
-};
+// Call func(chunkIndex) for each chunk, chunks are run in parallel if there are more than one.
+template <typename TypeFunc>
+void ForEachChunk(std::size_t numChunks, TypeFunc&& func)
+{
+    if (numChunks == 1)
+    {
+        func(std::size_t(0));
+        return;
+    }
 
-template <>
-struct TempCombination<false>
+    SelectCombination::RunParallelSlices(
+        numChunks, [&](std::size_t beginIndex, std::size_t endIndex, std::uint32_t) {
+            for (auto chunkIndex = beginIndex; chunkIndex < endIndex; ++chunkIndex)
+                func(chunkIndex);
+        });
+}
+
+inline std::size_t GetChunkBeginIndex(
+    std::size_t numTotal, std::size_t numChunks, std::size_t chunkIndex)
+{
+    return numTotal / numChunks * chunkIndex + std::min(numTotal % numChunks, chunkIndex);
+}
+
+// First index of combs in [0, numCombs) that the predicate is false, while it is true for all the
+// combs before.
+template <typename TypePredicate>
+std::size_t FindPartitionPoint(const ChunkedArena<TempCombination>& combs, std::size_t numCombs,
+    TypePredicate&& predicate)
 {
-    TempCombination() {}
-    TempCombination(float remainValue, std::uint64_t bitFlag, std::size_t hash) :
-        remainValue(remainValue), bitFlag(bitFlag)
+    std::size_t beginIndex = 0;
+    while (numCombs > 0)
     {
+        const auto half = numCombs / 2;
+        if (predicate(combs[beginIndex + half]))
+        {
+            beginIndex += half + 1;
+            numCombs -= half + 1;
+        }
+        else
+        {
+            numCombs = half;
+        }
     }
-    float remainValue = 0.0f;
-    // Bit flag represent the index of input vector that need to be removed
-    std::uint64_t bitFlag = 0;
-};
+    return beginIndex;
+}
+
+// Children of parents in [0, numParents) which pass canRemoveInput are written to outCombs from
+// outBeginIndex in order of the parents. The children of each chunk of parents are counted first,
+// then written to the offsets of the prefix sums of the counts. outCombs can be the same as the
+// parents if it does not overlap them. Returns false if the size of outCombs would exceed
+// maxNumCombs.
+template <typename TypeCanRemoveInput>
+bool ExpandCombChunks(const ChunkedArena<TempCombination>& parents, std::size_t numParents,
+    std::size_t numChunks, float inputData, std::uint64_t inputBitMask,
+    TypeCanRemoveInput&& canRemoveInput, std::size_t maxNumCombs,
+    ChunkedArena<TempCombination>& outCombs, std::size_t outBeginIndex,
+    std::vector<std::size_t>& outChunkOffsets)
+{
+    outChunkOffsets.assign(numChunks + 1, 0);
+    ForEachChunk(numChunks, [&](std::size_t chunkIndex) {
+        const auto endIndex = GetChunkBeginIndex(numParents, numChunks, chunkIndex + 1);
+        std::size_t numChildren = 0;
+        for (auto j = GetChunkBeginIndex(numParents, numChunks, chunkIndex); j < endIndex; ++j)
+        {
+            if (canRemoveInput(parents[j]))
+                ++numChildren;
+        }
+        outChunkOffsets[chunkIndex + 1] = numChildren;
+    });
+
+    std::partial_sum(outChunkOffsets.begin(), outChunkOffsets.end(), outChunkOffsets.begin());
+    for (auto& offset : outChunkOffsets)
+        offset += outBeginIndex;
+
+    if (outChunkOffsets.back() >= maxNumCombs)
+        return false;
+    outCombs.Resize(outChunkOffsets.back());
+
+    ForEachChunk(numChunks, [&](std::size_t chunkIndex) {
+        const auto endIndex = GetChunkBeginIndex(numParents, numChunks, chunkIndex + 1);
+        auto outIndex       = outChunkOffsets[chunkIndex];
+        for (auto j = GetChunkBeginIndex(numParents, numChunks, chunkIndex); j < endIndex; ++j)
+        {
+            const auto& parent = parents[j];
+            if (canRemoveInput(parent))
+            {
+                outCombs[outIndex++] = { parent.remainValue - inputData,
+                    parent.bitFlag | inputBitMask };
+            }
+        }
+    });
+    return true;
+}
+
+// Merge combs in [keptBeginIndex, keptEndIndex) and children to outCombs, which are all in
+// descending order of remain value, kept combs go first if the remain values are the same. Each
+// chunk of outCombs finds where it starts in both inputs by binary search along the merge path.
+void MergeSortedCombChunks(const ChunkedArena<TempCombination>& keptCombs,
+    std::size_t keptBeginIndex, std::size_t keptEndIndex,
+    const ChunkedArena<TempCombination>& children, std::size_t numChunks,
+    ChunkedArena<TempCombination>& outCombs)
+{
+    const auto numKept     = keptEndIndex - keptBeginIndex;
+    const auto numChildren = children.Size();
+    const auto numTotal    = numKept + numChildren;
+    outCombs.Resize(numTotal);
+
+    auto isKeptFirst = [&](std::size_t keptIndex, std::size_t childIndex) -> bool {
+        return keptCombs[keptBeginIndex + keptIndex].remainValue >=
+               children[childIndex].remainValue;
+    };
+
+    ForEachChunk(numChunks, [&](std::size_t chunkIndex) {
+        const auto outBeginIndex = GetChunkBeginIndex(numTotal, numChunks, chunkIndex);
+        const auto outEndIndex   = GetChunkBeginIndex(numTotal, numChunks, chunkIndex + 1);
+
+        // Number of kept combs in the first outBeginIndex combs of the output.
+        std::size_t low  = outBeginIndex > numChildren ? outBeginIndex - numChildren : 0;
+        std::size_t high = std::min(outBeginIndex, numKept);
+        while (low < high)
+        {
+            const auto mid = (low + high) / 2;
+            if (isKeptFirst(mid, outBeginIndex - mid - 1))
+                low = mid + 1;
+            else
+                high = mid;
+        }
+
+        auto keptIndex  = low;
+        auto childIndex = outBeginIndex - low;
+        for (auto outIndex = outBeginIndex; outIndex < outEndIndex; ++outIndex)
+        {
+            if (childIndex == numChildren ||
+                (keptIndex < numKept && isKeptFirst(keptIndex, childIndex)))
+            {
+                outCombs[outIndex] = keptCombs[keptBeginIndex + keptIndex++];
+            }
+            else
+            {
+                outCombs[outIndex] = children[childIndex++];
+            }
+        }
+    });
+}
+
+// Stable LSD radix sort of combs in [beginIndex, endIndex) in ascending order of diff, 8 bits of the
+// key per pass. Each chunk of combs counts its digits, then moves the combs to the offsets of the
+// prefix sums of (digit, chunk), chunks run in parallel if there are enough combs. Passes where all
+// keys have the same digit are skipped, and so is the sort if the combs are already sorted.
+void RadixSortCombsByDiff(std::vector<Combination::OutputCombination>& combVec,
+    std::size_t beginIndex, std::size_t endIndex)
+{
+    static constexpr std::uint32_t kNumDigitBits  = 8;
+    static constexpr std::uint32_t kNumDigits     = 1 << kNumDigitBits;
+    static constexpr std::uint32_t kNumPasses     = 32 / kNumDigitBits;
+    static constexpr std::size_t kMinParallelSize = std::size_t(1) << 16;
+
+    const auto size = endIndex - beginIndex;
+    if (std::is_sorted(combVec.begin() + beginIndex, combVec.begin() + endIndex,
+            [](const Combination::OutputCombination& a, const Combination::OutputCombination& b) {
+                return a.diff < b.diff;
+            }))
+        return;
+
+    // Ascending order of the keys is the same as the floats: flip all bits of negative ones, and
+    // the sign bit of the others.
+    auto getKey = [](const Combination::OutputCombination& comb) -> std::uint32_t {
+        std::uint32_t bits = 0;
+        std::memcpy(&bits, &comb.diff, sizeof(bits));
+        return (bits & 0x80000000u) != 0 ? ~bits : bits | 0x80000000u;
+    };
+
+    const auto numWorkers       = SelectCombination::GetNumParallelWorkers();
+    const std::size_t numChunks = numWorkers > 1 && size >= kMinParallelSize ? numWorkers : 1;
+
+    std::vector<Combination::OutputCombination> tempVec(size);
+    std::vector<std::array<std::size_t, kNumDigits>> digitOffsetsOfChunks(numChunks);
+    auto* pSrcCombs = combVec.data() + beginIndex;
+    auto* pDstCombs = tempVec.data();
+    for (std::uint32_t pass = 0; pass < kNumPasses; ++pass)
+    {
+        const auto shift = pass * kNumDigitBits;
+        auto getDigit    = [&](const Combination::OutputCombination& comb) -> std::uint32_t {
+            return (getKey(comb) >> shift) & (kNumDigits - 1);
+        };
+
+        ForEachChunk(numChunks, [&](std::size_t chunkIndex) {
+            auto& counts = digitOffsetsOfChunks[chunkIndex];
+            counts.fill(0);
+            const auto endIndex = GetChunkBeginIndex(size, numChunks, chunkIndex + 1);
+            for (auto i = GetChunkBeginIndex(size, numChunks, chunkIndex); i < endIndex; ++i)
+                ++counts[getDigit(pSrcCombs[i])];
+        });
+
+        std::size_t offset = 0;
+        bool canSkip       = false;
+        for (std::uint32_t digit = 0; digit < kNumDigits; ++digit)
+        {
+            const auto digitBeginOffset = offset;
+            for (auto& counts : digitOffsetsOfChunks)
+            {
+                const auto count = counts[digit];
+                counts[digit]    = offset;
+                offset += count;
+            }
+            canSkip = canSkip || offset - digitBeginOffset == size;
+        }
+        if (canSkip)
+            continue;
+
+        ForEachChunk(numChunks, [&](std::size_t chunkIndex) {
+            auto& offsets       = digitOffsetsOfChunks[chunkIndex];
+            const auto endIndex = GetChunkBeginIndex(size, numChunks, chunkIndex + 1);
+            for (auto i = GetChunkBeginIndex(size, numChunks, chunkIndex); i < endIndex; ++i)
+                pDstCombs[offsets[getDigit(pSrcCombs[i])]++] = std::move(pSrcCombs[i]);
+        });
+        std::swap(pSrcCombs, pDstCombs);
+    }
+
+    // Combs are sorted in the temp vec after an odd number of passes.
+    if (pSrcCombs != combVec.data() + beginIndex)
+    {
+        if (size == combVec.size())
+            combVec.swap(tempVec);
+        else
+            std::move(tempVec.begin(), tempVec.end(), combVec.begin() + beginIndex);
+    }
+}
+
+// Emit a comb to the buckets, returns false if the comb is below the target but not the comb of all
+// inputs.
+inline bool EmitComb(const TempCombination& comb, float targetData, std::uint64_t maxPickedIndices,
+    Combination::OutputCombinationBuckets& combBuckets)
+{
+    // Reverse "remove" to "pick" indices.
+    const auto indices = ~comb.bitFlag & maxPickedIndices;
+    const auto diff    = comb.remainValue - targetData;
+    combBuckets.Emit(comb.remainValue, diff, indices);
+    return diff >= 0 || indices == maxPickedIndices;
+}
+
+// Emit combs in [beginIndex, end) from the back to the buckets, which is ascending order of diff for
+// the sorted combs, and shrink the combs to beginIndex chunk by chunk to release the memory while
+// emitting.
+bool EmitCombsFromBack(ChunkedArena<TempCombination>& combs, std::size_t beginIndex,
+    float targetData, std::uint64_t maxPickedIndices,
+    Combination::OutputCombinationBuckets& combBuckets)
+{
+    static constexpr auto kChunkSize = ChunkedArena<TempCombination>::k_chunkSize;
+    combBuckets.Reserve(combs.Size() - std::min(beginIndex, combs.Size()));
+
+    bool isValid = true;
+    for (auto endIndex = combs.Size(); endIndex > beginIndex;)
+    {
+        const auto chunkBeginIndex = std::max(beginIndex, (endIndex - 1) & ~(kChunkSize - 1));
+        for (auto i = endIndex; i-- > chunkBeginIndex;)
+            isValid = EmitComb(combs[i], targetData, maxPickedIndices, combBuckets) && isValid;
+        combs.Resize(chunkBeginIndex);
+        endIndex = chunkBeginIndex;
+    }
+    return isValid;
+}
+
+// Emit all combs in order to the buckets, so that the combs of the same diff stay in order, and
+// release the chunks of combs while emitting.
+bool EmitAllCombs(ChunkedArena<TempCombination>& combs, float targetData,
+    std::uint64_t maxPickedIndices, Combination::OutputCombinationBuckets& combBuckets)
+{
+    combBuckets.Reserve(combs.Size());
+
+    bool isValid = true;
+    combs.ConsumeEach([&](const TempCombination& comb) {
+        isValid = EmitComb(comb, targetData, maxPickedIndices, combBuckets) && isValid;
+    });
+    return isValid;
+}
+} // namespace
+
+Combination::OutputCombinationBuckets::OutputCombinationBuckets(
+    float maxDiff, std::uint32_t numBuckets) :
+    m_maxDiff(maxDiff)
+{
+    // Without a max diff, or if it is not positive, there is nothing to split into buckets.
+    if (maxDiff > 0.0f && maxDiff < std::numeric_limits<float>::max())
+    {
+        m_buckets.resize(std::max(numBuckets, 1u));
+        m_bucketScale = static_cast<double>(m_buckets.size()) / maxDiff;
+    }
+}
+
+void Combination::OutputCombinationBuckets::Emit(
+    float sum, float diff, std::uint64_t selectedIndices)
+{
+    if (diff > m_maxDiff)
+        return;
+
+    if (m_buckets.empty())
+        m_combVec.emplace_back(sum, diff, selectedIndices);
+    else
+        m_buckets[getBucketIndex(diff)].EmplaceBack(sum, diff, selectedIndices);
+    m_peakSize = std::max(m_peakSize, ++m_size);
+}
+
+void Combination::OutputCombinationBuckets::Reserve(std::size_t numCombs)
+{
+    // Grow as the vec does, as it may be called for each input.
+    if (m_buckets.empty() && m_combVec.size() + numCombs > m_combVec.capacity())
+        m_combVec.reserve(std::max(m_combVec.size() + numCombs, m_combVec.capacity() * 2));
+}
+
+void Combination::OutputCombinationBuckets::MoveSortedTo(
+    std::vector<OutputCombination>& outCombVec)
+{
+    outCombVec.clear();
+    if (m_buckets.empty())
+    {
+        outCombVec.swap(m_combVec);
+        std::vector<OutputCombination>().swap(m_combVec);
+        RadixSortCombsByDiff(outCombVec, 0, outCombVec.size());
+    }
+    else
+    {
+        // Buckets are moved from the back, and shrunk chunk by chunk while they are moved, so
+        // that the combs are not kept twice. Each bucket is sorted on its own once all buckets are
+        // moved.
+        static constexpr auto kChunkSize =
+            ChunkedArena<OutputCombination, k_bucketChunkSizeBits>::k_chunkSize;
+        std::vector<std::size_t> bucketBeginIndices(m_buckets.size() + 1, m_size);
+        outCombVec.resize(m_size);
+        for (auto i = m_buckets.size(); i-- > 0;)
+        {
+            auto& bucket          = m_buckets[i];
+            const auto beginIndex = bucketBeginIndices[i + 1] - bucket.Size();
+            for (auto j = bucket.Size(); j-- > 0;)
+            {
+                outCombVec[beginIndex + j] = std::move(bucket[j]);
+                if ((j & (kChunkSize - 1)) == 0)
+                    bucket.Resize(j);
+            }
+            bucketBeginIndices[i] = beginIndex;
+        }
+        assert(bucketBeginIndices[0] == 0);
+
+        for (std::size_t i = 0; i < m_buckets.size(); ++i)
+            RadixSortCombsByDiff(outCombVec, bucketBeginIndices[i], bucketBeginIndices[i + 1]);
+    }
+    m_size = 0;
+}
+
+std::size_t Combination::OutputCombinationBuckets::getBucketIndex(float diff) const
+{
+    if (diff <= 0.0f)
+        return 0;
+    return static_cast<std::size_t>(std::min(static_cast<double>(diff) * m_bucketScale,
+        static_cast<double>(m_buckets.size() - 1)));
+}
 
-template <bool UseHashTable, std::uint32_t MaxCombSizeBits, typename TypeData>
+template <Combination::CombDeduplication Deduplication, bool UseSortedPruning,
+    std::uint32_t MaxCombSizeBits, typename TypeData, typename TypeCombTable>
 bool Combination::FindSumToTargetBackTracking(
     const InputSumToTargetDesc<TypeData>& inputDesc, std::string& errorStr)
 {
+    static_assert(!UseSortedPruning || Deduplication != CombDeduplication::HashTable,
+        "Hashes of combs are not sorted with the combs");
+
     if (inputDesc.targetValue == 0)
     {
         errorStr += "Target can not be 0\n";
@@ -306,10 +927,21 @@ bool Combination::FindSumToTargetBackTracking(
     auto targetValue = inputDesc.targetValue;
     auto inputSize   = static_cast<std::uint32_t>(inputDesc.inputVec.size());
 
-    // Init closest sum index of combsVec
+    // Init closest sum index of combs
     bool needsToOutPutClosestComb      = inputDesc.pOutClosestCombIndices != nullptr;
     std::uint64_t outClosetCombIndices = 0;
 
+    // All combs are streamed to the buckets whose max diff is refMinExeedSum, which are moved to
+    // pOutAllCombIndicesVec at the end.
+    const bool hasRefMinSum = inputDesc.refMinExeedSum >= 0.0f;
+    std::optional<OutputCombinationBuckets> allCombBuckets;
+    OutputCombinationBuckets* pCombBuckets = nullptr;
+    if (inputDesc.pOutAllCombIndicesVec)
+    {
+        pCombBuckets = &allCombBuckets.emplace(
+            hasRefMinSum ? inputDesc.refMinExeedSum : std::numeric_limits<float>::max());
+    }
+
     // Start the calculation scope
     constexpr auto kInvalidCombSize = GetInvalidValue(MaxCombSizeBits);
     {
@@ -325,112 +957,339 @@ bool Combination::FindSumToTargetBackTracking(
         auto optimizedTargetData =
             static_cast<float>(static_cast<double>(targetValue) / inputDesc.unitScale);
 
-        // This set is used for store hash values of each comb. Use our own hash function,
-        // as the value we store is already hashed.
-        struct Hasher
-        {
-            std::size_t operator()(const std::size_t& value) const { return value; }
-        };
-        std::unordered_set<std::size_t, Hasher, std::equal_to<std::size_t>> combTable;
-
-        std::vector<TempCombination<UseHashTable>> combsVec;
-        auto& init = combsVec.emplace_back();
-        for (auto& inputData : optimizedInputDataVec)
-        {
-            init.remainValue += inputData;
-        }
+        static constexpr bool kUseHashTable = Deduplication == CombDeduplication::HashTable;
+        static constexpr bool kUseCanonicalMultiset =
+            Deduplication == CombDeduplication::CanonicalMultiset;
 
-        if constexpr (UseHashTable)
+        // Bit mask of the previous input of the same value of each input, which must be removed
+        // before the input. 0 if there is no such input.
+        std::vector<std::uint64_t> prevEqualInputMasks(inputSize);
+        if constexpr (kUseCanonicalMultiset)
         {
-            // Add the init hash
-            combTable.insert(init.hash);
+            for (std::uint32_t i = 0; i < inputSize; ++i)
+            {
+                for (std::uint32_t j = i; j-- > 0;)
+                {
+                    if (inputDesc.inputVec[j] == inputDesc.inputVec[i])
+                    {
+                        prevEqualInputMasks[i] = PickIndex::k_inputIndexBitMask[j];
+                        break;
+                    }
+                }
+            }
+        }
+
+        // Combs are stored in chunks to avoid copies while growing, and hash of each comb is
+        // stored separately as it is only needed with the hash table.
+        ChunkedArena<TempCombination> combs;
+        ChunkedArena<std::size_t> combHashes;
+
+        // This set is used for store hash values of each comb, which are already hashed.
+        TypeCombTable combTable;
+
+        auto& init = combs.EmplaceBack();
+        for (auto& inputData : optimizedInputDataVec)
+        {
+            init.remainValue += inputData;
+        }
+
+        if constexpr (kUseHashTable)
+        {
+            // Reserve the table for estimated number of combs, but not too many in case that it
+            // is far from the truth.
+            static constexpr double kMaxReservedCombs = 1 << 24;
+            const auto estimatedNumCombs              = EstimateNumOfTempCombs(
+                optimizedInputDataVec, init.remainValue - optimizedTargetData);
+            combTable.Reserve(
+                static_cast<std::size_t>(std::min(estimatedNumCombs, kMaxReservedCombs)));
+
+            // Add the init hash
+            combHashes.EmplaceBack(std::size_t(0));
+            combTable.Insert(0);
         }
 
-        // Init closet index of combsVec
+        // Init closet index of combs
         std::uint32_t closetCombIndexOfVec = 0;
+        auto maxPickedIndices              = PickIndex::GetMaxPickedIndices(inputSize);
+
+        // Combs whose remain value can not reach the max diff of the buckets even if all the
+        // remaining inputs are removed are dropped during the expansion with UseSortedPruning,
+        // which is only done for all combs as the closest comb may be dropped. A margin is left
+        // for float rounding. Combs that no remaining input can be removed from are streamed out
+        // at the same time.
+        static constexpr double kCutOffMargin = 1e-4;
+        const bool canCutOff = !needsToOutPutClosestComb && pCombBuckets != nullptr;
+
+        // Combs are split into this number of chunks to be expanded in parallel, each worker
+        // takes a few of them to balance the workload.
+        const auto numWorkers                = SelectCombination::GetNumParallelWorkers();
+        const std::size_t numParallelChunks = numWorkers > 1 ? std::size_t(numWorkers) * 8 : 1;
+        std::vector<std::size_t> chunkOffsets;
+
+        // Sum and min of inputs from each index to the end.
+        std::vector<double> remainingInputSums(inputSize + 1, 0.0);
+        std::vector<float> minRemainingInputs(
+            inputSize + 1, std::numeric_limits<float>::infinity());
+        if constexpr (UseSortedPruning)
+        {
+            for (std::uint32_t i = inputSize; i-- > 0;)
+            {
+                remainingInputSums[i] = remainingInputSums[i + 1] + optimizedInputDataVec[i];
+                minRemainingInputs[i] =
+                    std::min(minRemainingInputs[i + 1], optimizedInputDataVec[i]);
+            }
+        }
 
         // Loop over all input data
         for (std::uint32_t i = 0; i < inputSize; ++i)
         {
-            auto combSize      = combsVec.size();
+            auto combSize      = combs.Size();
             auto& inputData    = optimizedInputDataVec[i];
             auto& inputBitMask = PickIndex::k_inputIndexBitMask[i];
+            const auto prevEqualInputMask = prevEqualInputMasks[i];
 
-            auto currentCombSize = combSize;
-            // Keep tracking previous combinations.
-            for (std::uint32_t j = 0; j < combSize; ++j)
-            {
-                // Keep substracting until the result is still larger than the target.
-                auto& comb = combsVec[j];
-
-                // Filter out same input value to be added with the same combination.
-                std::size_t currentHash = 0;
-                if constexpr (UseHashTable)
+            // Whether current input can be removed from the comb.
+            auto canRemoveInput = [&](const TempCombination& comb) -> bool {
+                if constexpr (kUseCanonicalMultiset)
                 {
-                    currentHash = comb.hash;
-                    HashCombine(currentHash, inputData);
-                    auto exist = combTable.find(currentHash) != combTable.end();
-                    if (exist)
-                        continue;
+                    if ((comb.bitFlag & prevEqualInputMask) != prevEqualInputMask)
+                        return false;
                 }
+                return comb.remainValue - inputData >= optimizedTargetData;
+            };
 
-                // Compute the difference
-                auto diff = comb.remainValue - inputData;
+            // Expand in parallel chunks once there are enough combs, which can not be done with
+            // the hash table.
+            const std::size_t numChunks = !kUseHashTable && numParallelChunks > 1 &&
+                    combSize >= k_minParallelBackTrackingSize
+                ? numParallelChunks
+                : 1;
 
-                // Get current flag
-                auto combFlag = comb.bitFlag;
-
-                // Our gloal is to find the subset that is closest and also greater equal to the
-                // target.
-                if (diff >= optimizedTargetData)
+            if constexpr (UseSortedPruning)
+            {
+                // Children of the combs are merged with the combs which are kept, so that the
+                // remain values stay in descending order.
+                const auto maxRemainValue = canCutOff
+                    ? (static_cast<double>(optimizedTargetData) + pCombBuckets->GetMaxDiff() +
+                          remainingInputSums[i + 1]) *
+                        (1.0 + kCutOffMargin)
+                    : std::numeric_limits<double>::max();
+                const auto keptIndex = FindPartitionPoint(combs, combSize,
+                    [&](const TempCombination& comb) { return comb.remainValue > maxRemainValue; });
+
+                // As the combs are sorted, no more child can stay above the target once one of
+                // them can not.
+                const auto numParents = FindPartitionPoint(
+                    combs, combSize, [&](const TempCombination& comb) {
+                        return comb.remainValue - inputData >= optimizedTargetData;
+                    });
+
+                ChunkedArena<TempCombination> nextCombs;
+                if (numChunks > 1)
                 {
-                    // If the data is too large throw an error.
-                    if (currentCombSize + 1 >= kInvalidCombSize)
+                    ChunkedArena<TempCombination> children;
+                    if (!ExpandCombChunks(combs, numParents, numChunks, inputData, inputBitMask,
+                            canRemoveInput, kInvalidCombSize - (combSize - keptIndex), children, 0,
+                            chunkOffsets))
                     {
                         errorStr += "Size of input is too large, try to use fewer inputs!\n";
                         return false;
                     }
+                    MergeSortedCombChunks(
+                        combs, keptIndex, combSize, children, numChunks, nextCombs);
+                }
+                else
+                {
+                    // Children are merged while they are generated.
+                    auto findNextParent = [&](std::size_t parentIndex) -> std::size_t {
+                        while (parentIndex < numParents && !canRemoveInput(combs[parentIndex]))
+                            ++parentIndex;
+                        return parentIndex;
+                    };
+
+                    auto currentKeptIndex = keptIndex;
+                    auto parentIndex      = findNextParent(0);
+                    while (currentKeptIndex < combSize || parentIndex < numParents)
+                    {
+                        // Kept comb goes first if the remain values are the same.
+                        if (parentIndex == numParents ||
+                            (currentKeptIndex < combSize &&
+                                combs[currentKeptIndex].remainValue >=
+                                    combs[parentIndex].remainValue - inputData))
+                        {
+                            nextCombs.EmplaceBack(combs[currentKeptIndex++]);
+                        }
+                        else
+                        {
+                            const auto& parent = combs[parentIndex];
+                            nextCombs.EmplaceBack(
+                                parent.remainValue - inputData, parent.bitFlag | inputBitMask);
+                            parentIndex = findNextParent(parentIndex + 1);
+                        }
+                    }
 
-                    // Combine the previous result with current index as another new result.
-                    auto& newComb =
-                        combsVec.emplace_back(diff, combFlag | inputBitMask, currentHash);
+                    // If the data is too large throw an error.
+                    if (nextCombs.Size() >= kInvalidCombSize)
+                    {
+                        errorStr += "Size of input is too large, try to use fewer inputs!\n";
+                        return false;
+                    }
+                }
+                combs = std::move(nextCombs);
 
-                    if constexpr (UseHashTable)
+                // Without a max diff nothing is dropped, combs are streamed out at the end in
+                // sorted order instead.
+                if (canCutOff && pCombBuckets->GetMaxDiff() < std::numeric_limits<float>::max())
+                {
+                    const auto minRemainingInput = minRemainingInputs[i + 1];
+                    const auto numExpandableCombs =
+                        FindPartitionPoint(combs, combs.Size(), [&](const TempCombination& comb) {
+                            return comb.remainValue - minRemainingInput >= optimizedTargetData;
+                        });
+                    if (!EmitCombsFromBack(combs, numExpandableCombs, optimizedTargetData,
+                            maxPickedIndices, *pCombBuckets))
                     {
-                        // Insert current hash
-                        combTable.insert(newComb.hash);
+                        errorStr += "All indices must be picked, when comb sum is not enough to "
+                                    "finish the pTarget\n";
+                        assert(false);
+                        return false;
                     }
+                }
+            }
+            else if (numChunks > 1)
+            {
+                if (!ExpandCombChunks(combs, combSize, numChunks, inputData, inputBitMask,
+                        canRemoveInput, kInvalidCombSize, combs, combSize, chunkOffsets))
+                {
+                    errorStr += "Size of input is too large, try to use fewer inputs!\n";
+                    return false;
+                }
+
+                // Get the optimal result, which is the first one of the closest in order of the
+                // combs as the sequential expansion.
+                if (needsToOutPutClosestComb)
+                {
+                    std::vector<std::size_t> closestIndexOfChunks(numChunks);
+                    ForEachChunk(numChunks, [&](std::size_t chunkIndex) {
+                        auto closestIndex = chunkOffsets[chunkIndex];
+                        for (auto j = closestIndex + 1; j < chunkOffsets[chunkIndex + 1]; ++j)
+                        {
+                            if (combs[j].remainValue < combs[closestIndex].remainValue)
+                                closestIndex = j;
+                        }
+                        closestIndexOfChunks[chunkIndex] = closestIndex;
+                    });
 
-                    // Get the optimal result
-                    if (needsToOutPutClosestComb)
+                    for (std::size_t chunkIndex = 0; chunkIndex < numChunks; ++chunkIndex)
                     {
-                        auto& closestComb = combsVec[closetCombIndexOfVec];
-                        if (newComb.remainValue < closestComb.remainValue)
+                        const auto closestIndex = closestIndexOfChunks[chunkIndex];
+                        if (closestIndex < chunkOffsets[chunkIndex + 1] &&
+                            combs[closestIndex].remainValue <
+                                combs[closetCombIndexOfVec].remainValue)
                         {
-                            // The closet index of vec is the newComb index of combsVec
-                            closetCombIndexOfVec = static_cast<std::uint32_t>(currentCombSize);
+                            closetCombIndexOfVec = static_cast<std::uint32_t>(closestIndex);
                         }
                     }
+                }
+            }
+            else
+            {
+                auto currentCombSize = combSize;
+                // Keep tracking previous combinations.
+                for (std::uint32_t j = 0; j < combSize; ++j)
+                {
+                    // Keep substracting until the result is still larger than the target.
+                    const auto& comb = combs[j];
+
+                    // Filter out same input value to be added with the same combination.
+                    if constexpr (kUseCanonicalMultiset)
+                    {
+                        if ((comb.bitFlag & prevEqualInputMask) != prevEqualInputMask)
+                            continue;
+                    }
+
+                    std::size_t currentHash = 0;
+                    if constexpr (kUseHashTable)
+                    {
+                        currentHash = combHashes[j];
+                        HashCombine(currentHash, inputData);
+                        if (combTable.Contains(currentHash))
+                            continue;
+                    }
+
+                    // Compute the difference
+                    auto diff = comb.remainValue - inputData;
+
+                    // Get current flag
+                    auto combFlag = comb.bitFlag;
+
+                    // Our gloal is to find the subset that is closest and also greater equal to the
+                    // target.
+                    if (diff >= optimizedTargetData)
+                    {
+                        // If the data is too large throw an error.
+                        if (currentCombSize + 1 >= kInvalidCombSize)
+                        {
+                            errorStr += "Size of input is too large, try to use fewer inputs!\n";
+                            return false;
+                        }
+
+                        // Combine the previous result with current index as another new result.
+                        auto& newComb = combs.EmplaceBack(diff, combFlag | inputBitMask);
+
+                        if constexpr (kUseHashTable)
+                        {
+                            // Insert current hash
+                            combHashes.EmplaceBack(currentHash);
+                            combTable.Insert(currentHash);
+                        }
+
+                        // Get the optimal result
+                        if (needsToOutPutClosestComb)
+                        {
+                            auto& closestComb = combs[closetCombIndexOfVec];
+                            if (newComb.remainValue < closestComb.remainValue)
+                            {
+                                // The closet index of vec is the newComb index of combs
+                                closetCombIndexOfVec = static_cast<std::uint32_t>(currentCombSize);
+                            }
+                        }
 
-                    ++currentCombSize;
+                        ++currentCombSize;
+                    }
                 }
             }
         }
 
+        if (UseSortedPruning && needsToOutPutClosestComb)
+        {
+            // The last comb is the closest, pick the first one of the same remain values.
+            closetCombIndexOfVec = static_cast<std::uint32_t>(combs.Size() - 1);
+            while (closetCombIndexOfVec > 0 &&
+                   combs[closetCombIndexOfVec - 1].remainValue ==
+                       combs[closetCombIndexOfVec].remainValue)
+            {
+                --closetCombIndexOfVec;
+            }
+        }
+
 #ifdef M_DEBUG
         {
             std::stringstream msg;
             msg << "Current targetValue is: " << targetValue
-                << " Size of combs: " << combsVec.size() << std::endl;
+                << " Size of combs: " << combs.Size() << std::endl;
             std::cout << msg.str();
         }
 #endif // M_DEBUG
 
-        auto maxPickedIndices = PickIndex::GetMaxPickedIndices(inputSize);
+        // Hashes are not needed anymore, release them before the output.
+        combHashes.Clear();
+        combTable = TypeCombTable();
+
         // Out put closest comb
         if (needsToOutPutClosestComb)
         {
-            auto& closestComb = combsVec[closetCombIndexOfVec];
+            auto& closestComb = combs[closetCombIndexOfVec];
             // Reverse "remove" to "pick" indices.
             outClosetCombIndices = ~closestComb.bitFlag;
             // Remove the unused bits.
@@ -439,60 +1298,30 @@ bool Combination::FindSumToTargetBackTracking(
             *inputDesc.pOutClosestCombIndices = outClosetCombIndices;
         }
 
-        // Out put all combs vec
-        if (inputDesc.pOutAllCombIndicesVec)
+        // Out put all combs
+        if (pCombBuckets)
         {
-            auto& outCombVec = *inputDesc.pOutAllCombIndicesVec;
-            outCombVec.clear();
-            auto size = combsVec.size();
-            outCombVec.reserve(size);
-
-            bool hasRefMinSum = inputDesc.refMinExeedSum >= 0.0f;
-
-            for (auto& comb : combsVec)
+            // Make sure all indices have been picked when comb sum can not finish the target.
+            const bool isValid = UseSortedPruning
+                ? EmitCombsFromBack(combs, 0, optimizedTargetData, maxPickedIndices, *pCombBuckets)
+                : EmitAllCombs(combs, optimizedTargetData, maxPickedIndices, *pCombBuckets);
+            if (!isValid)
             {
-                auto indices = ~comb.bitFlag;
-                indices &= maxPickedIndices;
-
-                auto diff = comb.remainValue - optimizedTargetData;
-                if (diff < 0)
-                {
-                    // Make sure all indices have been picked when comb sum can not finish the
-                    // target.
-                    if (indices != maxPickedIndices)
-                    {
-                        errorStr +=
-                            "All indices must be picked, when comb sum is not enough to finish the "
-                            "pTarget\n";
-                        assert(false);
-                        return false;
-                    }
-                }
-
-                if (hasRefMinSum)
-                {
-                    // Skip the diff that is already greater than ref min exeed.
-                    if (diff > inputDesc.refMinExeedSum)
-                        continue;
-                }
-
-                outCombVec.emplace_back(comb.remainValue, diff, indices);
+                errorStr +=
+                    "All indices must be picked, when comb sum is not enough to finish the "
+                    "pTarget\n";
+                assert(false);
+                return false;
             }
 
-            // Release the memory
-            combsVec.clear();
-
             // Sort by ascending order of diff
-            std::sort(std::execution::par, outCombVec.begin(), outCombVec.end(),
-                [](const OutputCombination& a, const OutputCombination& b) -> bool {
-                    return a.diff < b.diff;
-                });
+            pCombBuckets->MoveSortedTo(*inputDesc.pOutAllCombIndicesVec);
 
 #ifdef M_DEBUG
             {
                 std::stringstream msg;
                 msg << "Current targetValue is: " << targetValue
-                    << " Size of OutAllCombIndicesVec: " << outCombVec.size() << std::endl;
+                    << " Peak size of output combs: " << pCombBuckets->GetPeakSize() << std::endl;
                 std::cout << msg.str();
             }
 #endif // M_DEBUG
@@ -503,11 +1332,545 @@ bool Combination::FindSumToTargetBackTracking(
     return true;
 }
 
+template <Combination::CombDeduplication Deduplication, bool UseSortedPruning, typename TypeData>
+bool Combination::FindSumToTargetsBackTracking(const std::vector<TypeData>& inputVec,
+    const std::vector<TypeData>& targetVec, std::uint64_t unitScale,
+    std::vector<std::vector<OutputCombination>>& outAllCombIndicesVecs, float refMinExeedSum,
+    std::string& errorStr)
+{
+    if (targetVec.empty())
+    {
+        errorStr += "TargetVec can not be empty\n";
+        assert(false);
+        return false;
+    }
+
+    if (unitScale == 0)
+    {
+        errorStr += "UnitScale can not be 0\n";
+        assert(false);
+        return false;
+    }
+
+    const auto [minTargetIter, maxTargetIter] =
+        std::minmax_element(targetVec.begin(), targetVec.end());
+    const auto toOptimizedData = [&](TypeData data) -> float {
+        return static_cast<float>(static_cast<double>(data) / unitScale);
+    };
+    const auto minTargetData = toOptimizedData(*minTargetIter);
+    const auto maxTargetData = toOptimizedData(*maxTargetIter);
+
+    // Combs of the smallest target must cover refMinExeedSum of the largest target, with a margin
+    // for float rounding.
+    static constexpr double kRefMinExeedSumMargin = 1e-4;
+    const bool hasRefMinSum                       = refMinExeedSum >= 0.0f;
+    const auto sharedRefMinExeedSum               = hasRefMinSum
+        ? static_cast<float>(std::min(
+              (static_cast<double>(refMinExeedSum) + maxTargetData - minTargetData) *
+                  (1.0 + kRefMinExeedSumMargin),
+              static_cast<double>(std::numeric_limits<float>::max())))
+        : refMinExeedSum;
+
+    // Sorted by ascending order of remain value, as diff to the smallest target.
+    std::vector<OutputCombination> sharedCombVec;
+    {
+        InputSumToTargetDesc<TypeData> inputDesc(
+            inputVec, *minTargetIter, unitScale, nullptr, &sharedCombVec, sharedRefMinExeedSum);
+        if (!FindSumToTargetBackTracking<Deduplication, UseSortedPruning>(inputDesc, errorStr))
+            return false;
+    }
+
+    const auto maxPickedIndices = PickIndex::GetMaxPickedIndices(inputVec.size());
+    outAllCombIndicesVecs.resize(targetVec.size());
+    for (std::size_t targetIndex = 0; targetIndex < targetVec.size(); ++targetIndex)
+    {
+        const auto targetData = toOptimizedData(targetVec[targetIndex]);
+        auto& outCombVec      = outAllCombIndicesVecs[targetIndex];
+        outCombVec.clear();
+
+        for (const auto& comb : sharedCombVec)
+        {
+            if (comb.sum < targetData)
+                continue;
+
+            const auto diff = comb.sum - targetData;
+            if (hasRefMinSum && diff > refMinExeedSum)
+                continue;
+
+            outCombVec.emplace_back(comb.sum, diff, comb.selectedIndices);
+        }
+
+        // Sum of all inputs can not finish the target, which is the comb of all indices.
+        if (!sharedCombVec.empty() && sharedCombVec.back().selectedIndices == maxPickedIndices &&
+            sharedCombVec.back().sum < targetData)
+        {
+            const auto& allInputsComb = sharedCombVec.back();
+            outCombVec.emplace_back(
+                allInputsComb.sum, allInputsComb.sum - targetData, allInputsComb.selectedIndices);
+        }
+
+        // Sort by ascending order of diff
+        RadixSortCombsByDiff(outCombVec, 0, outCombVec.size());
+    }
+
+    return true;
+}
+
+namespace
+{
+template <typename TypeData>
+struct SubsetSum
+{
+    TypeData sum = 0;
+
+    // Bit flag represent the picked indices of input vector
+    std::uint64_t bitFlag = 0;
+};
+
+// Sums of all subsets of inputs in [beginIndex, endIndex) in ascending order. Each input merges
+// the sums without it and the sums with it, which are both sorted already, and subsets of the same
+// sum are kept only once. Both are merged from the back in place, so that the memory is only twice
+// the distinct sums.
+template <typename TypeData>
+void GetSortedSubsetSums(const std::vector<TypeData>& inputVec, std::uint32_t beginIndex,
+    std::uint32_t endIndex, std::vector<SubsetSum<TypeData>>& outSums)
+{
+    outSums.assign(1, {});
+    for (std::uint32_t i = beginIndex; i < endIndex; ++i)
+    {
+        const auto inputData    = inputVec[i];
+        const auto inputBitMask = PickIndex::k_inputIndexBitMask[i];
+
+        // Sums with the input are read from the sums without it, the write index is always after
+        // both read indices until the sums without the input are all in place.
+        const auto size = outSums.size();
+        outSums.reserve(size * 2);
+        outSums.resize(size * 2);
+        auto withoutIndex = size;
+        auto withIndex    = size;
+        for (auto writeIndex = size * 2; withIndex > 0;)
+        {
+            const auto& withSum = outSums[withIndex - 1];
+
+            // Subset without the input is kept on ties, which is before the one with it.
+            if (withoutIndex > 0 && outSums[withoutIndex - 1].sum > withSum.sum + inputData)
+            {
+                outSums[--writeIndex] = outSums[--withoutIndex];
+            }
+            else
+            {
+                outSums[--writeIndex] = {withSum.sum + inputData, withSum.bitFlag | inputBitMask};
+                --withIndex;
+            }
+        }
+
+        outSums.erase(std::unique(outSums.begin(), outSums.end(),
+                          [](const SubsetSum<TypeData>& a, const SubsetSum<TypeData>& b) {
+                              return a.sum == b.sum;
+                          }),
+            outSums.end());
+    }
+    outSums.shrink_to_fit();
+}
+
+// Subset sums of inputs in [beginIndex, endIndex) in ascending order, or descending if not
+// Ascending. Sums of a half which is small enough are kept in a table. Sums of a larger one are
+// merged from the sorted sums of its two quarters by a heap of one entry for each sum of the first
+// quarter, so that memory is only the sums of the quarters.
+template <typename TypeData, bool Ascending>
+class SubsetSumStream
+{
+public:
+    SubsetSumStream(
+        const std::vector<TypeData>& inputVec, std::uint32_t beginIndex, std::uint32_t endIndex)
+    {
+        if (endIndex - beginIndex <= Combination::k_maxMeetInTheMiddleHalfSize)
+        {
+            GetSortedSubsetSums(inputVec, beginIndex, endIndex, m_firstSums);
+            m_secondSums.assign(1, {});
+        }
+        else
+        {
+            const auto midIndex = beginIndex + (endIndex - beginIndex) / 2;
+            GetSortedSubsetSums(inputVec, beginIndex, midIndex, m_firstSums);
+            GetSortedSubsetSums(inputVec, midIndex, endIndex, m_secondSums);
+        }
+
+        if constexpr (!Ascending)
+        {
+            std::reverse(m_firstSums.begin(), m_firstSums.end());
+            std::reverse(m_secondSums.begin(), m_secondSums.end());
+        }
+
+        // Entries in the order of the first sums are a heap already.
+        if (m_secondSums.size() > 1)
+        {
+            m_heap.reserve(m_firstSums.size());
+            for (std::uint32_t i = 0; i < m_firstSums.size(); ++i)
+                m_heap.push_back({m_firstSums[i].sum + m_secondSums[0].sum, i, 0});
+        }
+    }
+
+    // Returns false if all sums are streamed.
+    bool Next(SubsetSum<TypeData>& outSum)
+    {
+        // Sums of a table are streamed in order.
+        if (m_secondSums.size() == 1)
+        {
+            if (m_nextIndex == m_firstSums.size())
+                return false;
+            outSum = m_firstSums[m_nextIndex++];
+            return true;
+        }
+
+        if (m_heap.empty())
+            return false;
+
+        auto& top         = m_heap.front();
+        const auto& first = m_firstSums[top.firstIndex];
+        outSum.sum        = top.sum;
+        outSum.bitFlag    = first.bitFlag | m_secondSums[top.secondIndex].bitFlag;
+        if (++top.secondIndex < m_secondSums.size())
+        {
+            top.sum = first.sum + m_secondSums[top.secondIndex].sum;
+        }
+        else
+        {
+            top = m_heap.back();
+            m_heap.pop_back();
+        }
+        if (!m_heap.empty())
+            siftDownTop();
+        return true;
+    }
+
+    std::size_t GetNumStoredSums() const { return m_firstSums.size() + m_secondSums.size(); }
+
+private:
+    struct HeapEntry
+    {
+        TypeData sum              = 0;
+        std::uint32_t firstIndex  = 0;
+        std::uint32_t secondIndex = 0;
+    };
+
+    static bool isBefore(TypeData a, TypeData b) { return Ascending ? a < b : a > b; }
+
+    void siftDownTop()
+    {
+        const auto entry  = m_heap.front();
+        const auto size   = m_heap.size();
+        std::size_t index = 0;
+        for (auto childIndex = std::size_t(1); childIndex < size; childIndex = index * 2 + 1)
+        {
+            const auto rightIndex = childIndex + 1;
+            if (rightIndex < size && isBefore(m_heap[rightIndex].sum, m_heap[childIndex].sum))
+                childIndex = rightIndex;
+            if (!isBefore(m_heap[childIndex].sum, entry.sum))
+                break;
+            m_heap[index] = m_heap[childIndex];
+            index         = childIndex;
+        }
+        m_heap[index] = entry;
+    }
+
+    std::vector<SubsetSum<TypeData>> m_firstSums;
+    std::vector<SubsetSum<TypeData>> m_secondSums;
+    std::vector<HeapEntry> m_heap;
+    std::size_t m_nextIndex = 0;
+};
+} // namespace
+
+template <typename TypeData>
+bool Combination::FindSumToTargetMeetInTheMiddle(
+    const InputSumToTargetDesc<TypeData>& inputDesc, std::string& errorStr)
+{
+    if (inputDesc.targetValue == 0)
+    {
+        errorStr += "Target can not be 0\n";
+        assert(false);
+        return false;
+    }
+
+    if (inputDesc.inputVec.empty())
+    {
+        errorStr += "InputVec can not be empty\n";
+        assert(false);
+        return false;
+    }
+
+    if (inputDesc.pOutClosestCombIndices == nullptr || inputDesc.pOutAllCombIndicesVec != nullptr)
+    {
+        errorStr += "Meet in the middle only outputs the closest comb\n";
+        assert(false);
+        return false;
+    }
+
+    const auto targetValue = inputDesc.targetValue;
+    const auto inputSize   = static_cast<std::uint32_t>(inputDesc.inputVec.size());
+
+    // Split inputs into two halves.
+    const std::uint32_t lowHalfSize = inputSize / 2;
+    if (inputSize > k_maxMeetInTheMiddleInputSize)
+    {
+        errorStr += "Size of input is too large, try to use fewer inputs!\n";
+        return false;
+    }
+
+    SubsetSumStream<TypeData, true> lowSums(inputDesc.inputVec, 0, lowHalfSize);
+    SubsetSumStream<TypeData, false> highSums(inputDesc.inputVec, lowHalfSize, inputSize);
+
+    // High sums go down while low sums go up, the low sum stays on the smallest low sum that
+    // finishes the target along with current high sum.
+    bool hasFound                      = false;
+    TypeData closestSum                = 0;
+    std::uint64_t outClosetCombIndices = PickIndex::GetMaxPickedIndices(inputSize);
+    SubsetSum<TypeData> lowSum;
+    SubsetSum<TypeData> highSum;
+    bool hasLowSum = lowSums.Next(lowSum);
+    while (hasLowSum && highSums.Next(highSum))
+    {
+        while (hasLowSum && lowSum.sum + highSum.sum < targetValue)
+            hasLowSum = lowSums.Next(lowSum);
+
+        if (!hasLowSum)
+            break;
+
+        const auto sum = lowSum.sum + highSum.sum;
+        if (!hasFound || sum < closestSum)
+        {
+            hasFound             = true;
+            closestSum           = sum;
+            outClosetCombIndices = lowSum.bitFlag | highSum.bitFlag;
+
+            // Can not be any closer.
+            if (sum == targetValue)
+                break;
+        }
+    }
+
+#ifdef M_DEBUG
+    {
+        std::stringstream msg;
+        msg << "Current targetValue is: " << targetValue
+            << " Stored low sums: " << lowSums.GetNumStoredSums()
+            << " Stored high sums: " << highSums.GetNumStoredSums() << std::endl;
+        std::cout << msg.str();
+    }
+#endif // M_DEBUG
+
+    *inputDesc.pOutClosestCombIndices = outClosetCombIndices;
+    return true;
+}
+
+namespace
+{
+// Sums of dynamic programming are in unit of the gcd of all inputs, which is 1 if all are 0.
+template <typename TypeData>
+TypeData GetSumUnit(const std::vector<TypeData>& inputVec)
+{
+    TypeData gcd = 0;
+    for (const auto input : inputVec)
+        gcd = std::gcd(gcd, input);
+    return gcd == 0 ? 1 : gcd;
+}
+
+// Target in unit of sums, rounded up.
+template <typename TypeData>
+std::uint64_t GetScaledTarget(TypeData targetValue, TypeData sumUnit)
+{
+    return static_cast<std::uint64_t>(targetValue / sumUnit + (targetValue % sumUnit != 0));
+}
+} // namespace
+
+template <typename TypeData>
+std::uint64_t Combination::GetDynamicProgrammingSumSize(
+    const InputSumToTargetDesc<TypeData>& inputDesc)
+{
+    const auto sumUnit = GetSumUnit(inputDesc.inputVec);
+    const auto maxInput =
+        *std::max_element(inputDesc.inputVec.begin(), inputDesc.inputVec.end()) / sumUnit;
+
+    // Removing any input of the closest comb makes it less than the target, so that the closest
+    // sum is less than target + max input.
+    return GetScaledTarget(inputDesc.targetValue, sumUnit) + static_cast<std::uint64_t>(maxInput);
+}
+
+template <typename TypeData>
+bool Combination::FindSumToTargetDynamicProgramming(
+    const InputSumToTargetDesc<TypeData>& inputDesc, std::string& errorStr)
+{
+    if (inputDesc.targetValue == 0)
+    {
+        errorStr += "Target can not be 0\n";
+        assert(false);
+        return false;
+    }
+
+    if (inputDesc.inputVec.empty())
+    {
+        errorStr += "InputVec can not be empty\n";
+        assert(false);
+        return false;
+    }
+
+    if (inputDesc.pOutClosestCombIndices == nullptr || inputDesc.pOutAllCombIndicesVec != nullptr)
+    {
+        errorStr += "Dynamic programming only outputs the closest comb\n";
+        assert(false);
+        return false;
+    }
+
+    const auto& inputVec = inputDesc.inputVec;
+    const auto inputSize = static_cast<std::uint32_t>(inputVec.size());
+    if (inputSize >= PickIndex::k_maxInputSize)
+    {
+        errorStr += "Size of input is too large, try to use fewer inputs!\n";
+        return false;
+    }
+
+    const auto sumSize = GetDynamicProgrammingSumSize(inputDesc);
+    if (sumSize > k_maxDynamicProgrammingSumSize)
+    {
+        errorStr += "Input values are too large for dynamic programming!\n";
+        return false;
+    }
+
+    const auto sumUnit      = GetSumUnit(inputVec);
+    const auto scaledTarget = GetScaledTarget(inputDesc.targetValue, sumUnit);
+
+    // Bit array of reachable sums, sum 0 is reachable by picking nothing.
+    const std::size_t numWords = static_cast<std::size_t>((sumSize + 63) / 64);
+    const std::uint64_t lastWordMask =
+        sumSize % 64 == 0 ? ~std::uint64_t(0) : (std::uint64_t(1) << (sumSize % 64)) - 1;
+    std::vector<std::uint64_t> reachableSums(numWords);
+    reachableSums[0] = 1;
+
+    // Index of the input which reaches the sum first, the rest of the sum is reachable by the
+    // inputs before it.
+    std::vector<std::uint8_t> parentInputIndices(static_cast<std::size_t>(sumSize));
+
+    for (std::uint32_t i = 0; i < inputSize; ++i)
+    {
+        const auto scaledInput = static_cast<std::uint64_t>(inputVec[i] / sumUnit);
+        if (scaledInput == 0)
+            continue;
+
+        // Shift by whole words and bits, from high words to low words so that every input is only
+        // picked once.
+        const auto wordShift = static_cast<std::size_t>(scaledInput / 64);
+        const auto bitShift  = static_cast<std::uint32_t>(scaledInput % 64);
+        for (std::size_t word = numWords; word-- > wordShift;)
+        {
+            std::uint64_t shiftedSums = reachableSums[word - wordShift] << bitShift;
+            if (bitShift != 0 && word > wordShift)
+                shiftedSums |= reachableSums[word - wordShift - 1] >> (64 - bitShift);
+            if (word == numWords - 1)
+                shiftedSums &= lastWordMask;
+
+            const auto newSums = shiftedSums & ~reachableSums[word];
+            if (newSums == 0)
+                continue;
+
+            reachableSums[word] |= newSums;
+            BitHelper::ForEachSetBit(newSums, [&](std::uint32_t bitIndex) {
+                parentInputIndices[word * 64 + bitIndex] = static_cast<std::uint8_t>(i);
+            });
+        }
+    }
+
+    // Smallest reachable sum greater equal to the target.
+    constexpr auto kInvalidSum = std::numeric_limits<std::uint64_t>::max();
+    std::uint64_t closestSum   = kInvalidSum;
+    for (auto word = static_cast<std::size_t>(scaledTarget / 64); word < numWords; ++word)
+    {
+        auto sums = reachableSums[word];
+        if (word == scaledTarget / 64)
+            sums &= ~std::uint64_t(0) << (scaledTarget % 64);
+        if (sums != 0)
+        {
+            closestSum = word * 64 + BitHelper::CountTrailingZeros(sums);
+            break;
+        }
+    }
+
+#ifdef M_DEBUG
+    {
+        std::stringstream msg;
+        msg << "Current targetValue is: " << inputDesc.targetValue << " Size of sums: " << sumSize
+            << std::endl;
+        std::cout << msg.str();
+    }
+#endif // M_DEBUG
+
+    // Sum of all inputs can not finish the target.
+    if (closestSum == kInvalidSum)
+    {
+        *inputDesc.pOutClosestCombIndices = PickIndex::GetMaxPickedIndices(inputSize);
+        return true;
+    }
+
+    // Walk back through the parents.
+    std::uint64_t outClosetCombIndices = 0;
+    for (auto sum = closestSum; sum != 0;)
+    {
+        const auto inputIndex = parentInputIndices[static_cast<std::size_t>(sum)];
+        outClosetCombIndices |= PickIndex::k_inputIndexBitMask[inputIndex];
+        sum -= inputVec[inputIndex] / sumUnit;
+    }
+
+    *inputDesc.pOutClosestCombIndices = outClosetCombIndices;
+    return true;
+}
+
 // Explicit template instanciation
-template bool Combination::FindSumToTargetBackTracking<true, 32, std::uint64_t>(
+template bool Combination::FindSumToTargetBackTracking<
+    Combination::CombDeduplication::CanonicalMultiset, false, 32, std::uint64_t, PreHashedFlatSet>(
+    const InputSumToTargetDesc<std::uint64_t>&, std::string&);
+
+template bool Combination::FindSumToTargetBackTracking<
+    Combination::CombDeduplication::CanonicalMultiset, true, 32, std::uint64_t, PreHashedFlatSet>(
+    const InputSumToTargetDesc<std::uint64_t>&, std::string&);
+
+template bool Combination::FindSumToTargetBackTracking<Combination::CombDeduplication::None, false,
+    32, std::uint64_t, PreHashedFlatSet>(const InputSumToTargetDesc<std::uint64_t>&, std::string&);
+
+template bool Combination::FindSumToTargetBackTracking<Combination::CombDeduplication::None, true,
+    32, std::uint64_t, PreHashedFlatSet>(const InputSumToTargetDesc<std::uint64_t>&, std::string&);
+
+template bool Combination::FindSumToTargetBackTracking<Combination::CombDeduplication::HashTable,
+    false, 32, std::uint64_t, PreHashedFlatSet>(
     const InputSumToTargetDesc<std::uint64_t>&, std::string&);
 
-template bool Combination::FindSumToTargetBackTracking<false, 32, std::uint64_t>(
+template bool Combination::FindSumToTargetBackTracking<Combination::CombDeduplication::HashTable,
+    false, 32, std::uint64_t, PreHashedStdSet>(
+    const InputSumToTargetDesc<std::uint64_t>&, std::string&);
+
+template bool Combination::FindSumToTargetsBackTracking<
+    Combination::CombDeduplication::CanonicalMultiset, false, std::uint64_t>(
+    const std::vector<std::uint64_t>&, const std::vector<std::uint64_t>&, std::uint64_t,
+    std::vector<std::vector<OutputCombination>>&, float, std::string&);
+
+template bool Combination::FindSumToTargetsBackTracking<
+    Combination::CombDeduplication::CanonicalMultiset, true, std::uint64_t>(
+    const std::vector<std::uint64_t>&, const std::vector<std::uint64_t>&, std::uint64_t,
+    std::vector<std::vector<OutputCombination>>&, float, std::string&);
+
+template bool Combination::FindSumToTargetsBackTracking<Combination::CombDeduplication::None,
+    false, std::uint64_t>(const std::vector<std::uint64_t>&, const std::vector<std::uint64_t>&,
+    std::uint64_t, std::vector<std::vector<OutputCombination>>&, float, std::string&);
+
+template bool Combination::FindSumToTargetsBackTracking<Combination::CombDeduplication::None,
+    true, std::uint64_t>(const std::vector<std::uint64_t>&, const std::vector<std::uint64_t>&,
+    std::uint64_t, std::vector<std::vector<OutputCombination>>&, float, std::string&);
+
+template bool Combination::FindSumToTargetMeetInTheMiddle<std::uint64_t>(
+    const InputSumToTargetDesc<std::uint64_t>&, std::string&);
+
+template std::uint64_t Combination::GetDynamicProgrammingSumSize<std::uint64_t>(
+    const InputSumToTargetDesc<std::uint64_t>&);
+
+template bool Combination::FindSumToTargetDynamicProgramming<std::uint64_t>(
     const InputSumToTargetDesc<std::uint64_t>&, std::string&);
 
 } // namespace JUtils
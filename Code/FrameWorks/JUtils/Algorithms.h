@@ -4,7 +4,12 @@
 #pragma once
 
 #include "Utils.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <functional>
+#include <mutex>
+#include <thread>
 
 namespace JUtils
 {
@@ -63,6 +68,78 @@ struct SelectCombination
     static std::size_t RunMultiThread(std::size_t numElelment, std::size_t numSelect,
         std::function<void(const std::vector<std::size_t>&, std::size_t)> callBack);
 
+    // Get the combination at given index of lexicographic order, e.g. C{5,3} index 3 is {0,2,3}.
+    static void UnrankCombination(std::size_t numElelment, std::size_t numSelect,
+        std::size_t indexOfComb, std::vector<std::size_t>& outComb);
+
+    // Advance comb to the next one of lexicographic order in place, returns false if comb is the
+    // last one.
+    static bool NextCombination(std::size_t numElelment, std::vector<std::size_t>& comb);
+
+    // Parallel solution, each worker enumerates disjoint slices of the combinations. The index of
+    // current worker is passed to callBack as the last argument, so that the caller can keep
+    // states per worker without any synchronization.
+    static std::size_t RunParallel(std::size_t numElelment, std::size_t numSelect,
+        std::function<void(const std::vector<std::size_t>&, std::size_t, std::uint32_t)> callBack);
+
+    // Number of workers used by RunParallel, which is used to allocate states per worker.
+    static std::uint32_t GetNumParallelWorkers();
+
+    // Split [0, numTotal) into slices of continuous index, workers keep fetching slices until all
+    // of them are consumed. sliceCallBack(beginIndex, endIndex, workerIndex).
+    static void RunParallelSlices(std::size_t numTotal,
+        std::function<void(std::size_t, std::size_t, std::uint32_t)> sliceCallBack);
+
+    // Next bit mask with the same number of set bits by Gosper's hack, mask must not be 0.
+    static inline std::uint64_t NextBitMaskComb(std::uint64_t mask)
+    {
+        auto lowestBit = mask & (~mask + 1);
+        auto ripple    = mask + lowestBit;
+        return (((ripple ^ mask) >> 2) >> BitHelper::CountTrailingZeros(mask)) | ripple;
+    }
+
+    // Get the bit mask comb at given index of increasing mask order (colexicographic order), e.g.
+    // C{5,3} index 3 is 0b01101.
+    static std::uint64_t UnrankBitMaskComb(
+        std::size_t numElelment, std::size_t numSelect, std::size_t indexOfComb);
+
+    // For two different bit mask combs of the same size, whether a is ahead of b in lexicographic
+    // order of their indices, which is the one holding the lowest different bit.
+    static inline bool IsBitMaskCombLexLess(std::uint64_t a, std::uint64_t b)
+    {
+        auto diff = a ^ b;
+        return (a & diff & (~diff + 1)) != 0;
+    }
+
+    // Bit mask solution for numElelment <= 64, combs are enumerated as bit masks in increasing
+    // order, bit i is set when element i is selected. Use BitHelper::ForEachSetBit to visit the
+    // selected elements. callBack(mask, indexOfComb), the index is of increasing mask order.
+    template <typename TypeCallBack>
+    static std::size_t RunBitMask(
+        std::size_t numElelment, std::size_t numSelect, TypeCallBack&& callBack)
+    {
+        const auto totalNumCombs = GetNumOfSelectionComb(numElelment, numSelect);
+        RunBitMaskRange(numElelment, numSelect, 0, totalNumCombs,
+            [&](std::uint64_t mask, std::size_t indexOfComb) { callBack(mask, indexOfComb); });
+        return totalNumCombs;
+    }
+
+    // Parallel version of RunBitMask, callBack(mask, indexOfComb, workerIndex).
+    template <typename TypeCallBack>
+    static std::size_t RunBitMaskParallel(
+        std::size_t numElelment, std::size_t numSelect, TypeCallBack&& callBack)
+    {
+        const auto totalNumCombs = GetNumOfSelectionComb(numElelment, numSelect);
+        RunParallelSlices(totalNumCombs,
+            [&](std::size_t beginIndex, std::size_t endIndex, std::uint32_t workerIndex) {
+                RunBitMaskRange(numElelment, numSelect, beginIndex, endIndex,
+                    [&](std::uint64_t mask, std::size_t indexOfComb) {
+                        callBack(mask, indexOfComb, workerIndex);
+                    });
+            });
+        return totalNumCombs;
+    }
+
     struct SelectGroupComb
     {
         template <typename TypeCallBack>
@@ -86,6 +163,180 @@ struct SelectCombination
 
         std::function<void(const std::vector<std::uint64_t>&)> m_callBack;
     };
+
+    // Removed/added index passed to the callBack of RunRevolvingDoorParallel for the first comb
+    // of each slice, which must be evaluated from scratch.
+    static constexpr std::uint32_t k_revolvingDoorNoChange = std::numeric_limits<std::uint32_t>::max();
+
+    // Get the comb at given index of revolving door order, which is defined as
+    // R(n, k) = R(n - 1, k), reversed R(n - 1, k - 1) with n - 1 appended. Comb is in ascending
+    // order.
+    static void UnrankRevolvingDoorComb(std::size_t numElelment, std::size_t numSelect,
+        std::size_t indexOfComb, std::vector<std::size_t>& outComb);
+
+    // Advance comb to the next one of revolving door order in place (Knuth's Algorithm R), exactly
+    // one element is removed and one is added. Returns false if comb is the last one.
+    static bool NextRevolvingDoorComb(std::size_t numElelment, std::vector<std::size_t>& comb,
+        std::size_t& outRemoved, std::size_t& outAdded);
+
+    // Minimal change solution for numElelment <= 64, so that the caller can update the states of
+    // previous comb by removing one element and adding one instead of evaluating all of them.
+    // callBack(mask, removedIndex, addedIndex, indexOfComb, workerIndex), removedIndex and
+    // addedIndex are k_revolvingDoorNoChange for the first comb of each slice.
+    template <typename TypeCallBack>
+    static std::size_t RunRevolvingDoorParallel(
+        std::size_t numElelment, std::size_t numSelect, TypeCallBack&& callBack)
+    {
+        assert(numElelment <= PickIndex::k_maxInputSize);
+
+        const auto totalNumCombs = GetNumOfSelectionComb(numElelment, numSelect);
+        RunParallelSlices(totalNumCombs,
+            [&](std::size_t beginIndex, std::size_t endIndex, std::uint32_t workerIndex) {
+                std::vector<std::size_t> comb;
+                UnrankRevolvingDoorComb(numElelment, numSelect, beginIndex, comb);
+
+                std::uint64_t mask = 0;
+                for (auto index : comb)
+                    mask |= PickIndex::k_inputIndexBitMask[index];
+                callBack(mask, k_revolvingDoorNoChange, k_revolvingDoorNoChange, beginIndex,
+                    workerIndex);
+
+                std::size_t removed = 0;
+                std::size_t added   = 0;
+                for (auto indexOfComb = beginIndex + 1; indexOfComb < endIndex; ++indexOfComb)
+                {
+                    NextRevolvingDoorComb(numElelment, comb, removed, added);
+                    mask ^= PickIndex::k_inputIndexBitMask[removed] |
+                        PickIndex::k_inputIndexBitMask[added];
+                    callBack(mask, static_cast<std::uint32_t>(removed),
+                        static_cast<std::uint32_t>(added), indexOfComb, workerIndex);
+                }
+            });
+        return totalNumCombs;
+    }
+
+    // Statistics of RunBranchAndBoundParallel
+    struct BranchAndBoundStats
+    {
+        // Number of combs reaching leafFunc
+        std::size_t numLeaves = 0;
+        // Number of partial combs cut by pruneFunc
+        std::size_t numPrunedNodes = 0;
+        // Number of combs skipped by the pruned partial combs
+        std::size_t numPrunedCombs = 0;
+    };
+
+    // Depth first search of combs in lexicographic order with pruning, for numElelment <= 64.
+    // The state of a partial comb is copied from its parent and then addFunc(state, index) is
+    // called with the newly selected element. pruneFunc(state, nextIndex, numLeft, workerIndex)
+    // returns true if none of the combs completed by picking numLeft elements from [nextIndex,
+    // numElelment) needs to be visited. leafFunc(state, mask, workerIndex) is called for each
+    // visited comb. Partial combs of the first levels are distributed to the parallel workers.
+    template <typename TypeState, typename TypeAddFunc, typename TypePruneFunc,
+        typename TypeLeafFunc>
+    static BranchAndBoundStats RunBranchAndBoundParallel(std::size_t numElelment,
+        std::size_t numSelect, const TypeState& rootState, TypeAddFunc&& addFunc,
+        TypePruneFunc&& pruneFunc, TypeLeafFunc&& leafFunc)
+    {
+        assert(numElelment <= PickIndex::k_maxInputSize);
+
+        std::vector<BranchAndBoundStats> workerStatsVec(GetNumParallelWorkers());
+        if (numSelect == 0 || numSelect > numElelment)
+            return {};
+
+        // Each task is a prefix of the combs, all prefixes are in the first
+        // numElelment - numSelect + numPrefix elements.
+        static constexpr std::size_t kMaxPrefixSize = 2;
+        const auto numPrefix         = std::min(numSelect, kMaxPrefixSize);
+        const auto numPrefixElements = numElelment - numSelect + numPrefix;
+        const auto numTasks          = GetNumOfSelectionComb(numPrefixElements, numPrefix);
+
+        RunParallelSlices(numTasks,
+            [&](std::size_t beginIndex, std::size_t endIndex, std::uint32_t workerIndex) {
+                auto& stats = workerStatsVec[workerIndex];
+                std::vector<std::size_t> prefix;
+                std::vector<TypeState> stateStack(numSelect + 1, rootState);
+
+                for (auto taskIndex = beginIndex; taskIndex < endIndex; ++taskIndex)
+                {
+                    UnrankCombination(numPrefixElements, numPrefix, taskIndex, prefix);
+
+                    std::uint64_t mask = 0;
+                    for (std::size_t depth = 0; depth < numPrefix; ++depth)
+                    {
+                        stateStack[depth + 1] = stateStack[depth];
+                        addFunc(stateStack[depth + 1], prefix[depth]);
+                        mask |= PickIndex::k_inputIndexBitMask[prefix[depth]];
+                    }
+
+                    BranchAndBoundRecursion(numElelment, numSelect, numPrefix, prefix.back() + 1,
+                        mask, stateStack, addFunc, pruneFunc, leafFunc, workerIndex, stats);
+                }
+            });
+
+        BranchAndBoundStats out;
+        for (const auto& stats : workerStatsVec)
+        {
+            out.numLeaves += stats.numLeaves;
+            out.numPrunedNodes += stats.numPrunedNodes;
+            out.numPrunedCombs += stats.numPrunedCombs;
+        }
+        return out;
+    }
+
+private:
+    template <typename TypeState, typename TypeAddFunc, typename TypePruneFunc,
+        typename TypeLeafFunc>
+    static void BranchAndBoundRecursion(std::size_t numElelment, std::size_t numSelect,
+        std::size_t depth, std::size_t nextIndex, std::uint64_t mask,
+        std::vector<TypeState>& stateStack, TypeAddFunc& addFunc, TypePruneFunc& pruneFunc,
+        TypeLeafFunc& leafFunc, std::uint32_t workerIndex, BranchAndBoundStats& stats)
+    {
+        if (depth == numSelect)
+        {
+            leafFunc(stateStack[depth], mask, workerIndex);
+            ++stats.numLeaves;
+            return;
+        }
+
+        const auto numLeft = numSelect - depth;
+        if (pruneFunc(stateStack[depth], nextIndex, numLeft, workerIndex))
+        {
+            ++stats.numPrunedNodes;
+            stats.numPrunedCombs += GetNumOfSelectionComb(numElelment - nextIndex, numLeft);
+            return;
+        }
+
+        for (auto index = nextIndex; index + numLeft <= numElelment; ++index)
+        {
+            stateStack[depth + 1] = stateStack[depth];
+            addFunc(stateStack[depth + 1], index);
+            BranchAndBoundRecursion(numElelment, numSelect, depth + 1, index + 1,
+                mask | PickIndex::k_inputIndexBitMask[index], stateStack, addFunc, pruneFunc,
+                leafFunc, workerIndex, stats);
+        }
+    }
+
+    // Enumerate bit mask combs in range of [beginIndex, endIndex), only the first one is unranked.
+    template <typename TypeCallBack>
+    static void RunBitMaskRange(std::size_t numElelment, std::size_t numSelect,
+        std::size_t beginIndex, std::size_t endIndex, TypeCallBack&& callBack)
+    {
+        assert(numElelment <= PickIndex::k_maxInputSize);
+        if (beginIndex >= endIndex)
+            return;
+
+        // Iterate by count instead of comparing to the end mask, which overflows when
+        // numElelment is 64.
+        auto mask = UnrankBitMaskComb(numElelment, numSelect, beginIndex);
+        for (auto indexOfComb = beginIndex;;)
+        {
+            callBack(mask, indexOfComb);
+            if (++indexOfComb == endIndex)
+                break;
+            mask = NextBitMaskComb(mask);
+        }
+    }
 };
 
 // Helper for combination related calculations
@@ -93,6 +344,7 @@ struct Combination
 {
     struct OutputCombination
     {
+        OutputCombination() = default;
         OutputCombination(float sum, float diff, std::uint64_t selectedIndices) :
             sum(sum), diff(diff), selectedIndices(selectedIndices) {};
 
@@ -107,6 +359,47 @@ struct Combination
     };
     static_assert(sizeof(OutputCombination) == sizeof(float) * 2 + sizeof(std::uint64_t));
 
+    // Combs streamed out of FindSumToTargetBackTracking while they are generated. Combs whose diff
+    // is greater than the max diff are dropped at once, the others are kept in buckets of diff
+    // ranges, so that each bucket is sorted on its own at the end.
+    class OutputCombinationBuckets
+    {
+    public:
+        static constexpr std::uint32_t k_defaultNumBuckets = 64;
+
+        explicit OutputCombinationBuckets(
+            float maxDiff            = std::numeric_limits<float>::max(),
+            std::uint32_t numBuckets = k_defaultNumBuckets);
+
+        // Reserve is only done without a max diff, when all combs are kept in the same vec.
+        void Emit(float sum, float diff, std::uint64_t selectedIndices);
+        void Reserve(std::size_t numCombs);
+
+        float GetMaxDiff() const { return m_maxDiff; }
+
+        std::size_t Size() const { return m_size; }
+        std::size_t GetPeakSize() const { return m_peakSize; }
+
+        // Move out all combs in ascending order of diff, bucket by bucket.
+        void MoveSortedTo(std::vector<OutputCombination>& outCombVec);
+
+    private:
+        std::size_t getBucketIndex(float diff) const;
+
+        // Small chunks of buckets keep the memory of the partially filled chunks low. Without a
+        // max diff, there are no buckets and all combs are kept in the vec.
+        static constexpr std::uint32_t k_bucketChunkSizeBits = 10;
+        std::vector<ChunkedArena<OutputCombination, k_bucketChunkSizeBits>> m_buckets;
+        std::vector<OutputCombination> m_combVec;
+        const float m_maxDiff;
+
+        // Number of buckets per unit of diff, from the max diff.
+        double m_bucketScale = 0.0;
+
+        std::size_t m_size     = 0;
+        std::size_t m_peakSize = 0;
+    };
+
     // Descriptor pass to FindSumToTargetBackTracking
     template <typename TypeData, typename = typename std::enable_if_t<std::is_unsigned_v<TypeData>>>
     struct InputSumToTargetDesc
@@ -136,11 +429,254 @@ struct Combination
     };
 
 
+    // How FindSumToTargetBackTracking skips the combs which remove the same values as another comb.
+    enum class CombDeduplication
+    {
+        None,
+
+        // Hash of the removed values of each comb is kept in a table, a hash collision drops a
+        // valid comb.
+        HashTable,
+
+        // An input is only removed after the previous input of the same value, so that each
+        // multiset of values is built exactly once without any table.
+        CanonicalMultiset
+    };
+
+    // FindSumToTargetBackTracking expands the combs of each input in parallel chunks once there are
+    // this number of combs, unless the hash table is used.
+    static constexpr std::size_t k_minParallelBackTrackingSize = std::size_t(1) << 20;
+
+    // UseSortedPruning keeps combs sorted by remain value, so that each input only visits the
+    // combs which can still stay above the target, and combs that can not reach refMinExeedSum are
+    // dropped during the expansion when only all combs are output. It does not work with the hash
+    // table.
     // MaxCombSizeBits is used for max combination size of each calculation. 32 means 2 ^ 32 combinations is
-    // allowed in memory.
-    template <bool UseHashTable = true, std::uint32_t MaxCombSizeBits = 32, typename TypeData = std::uint64_t>
+    // allowed in memory. TypeCombTable is the set of comb hashes of CombDeduplication::HashTable,
+    // which has the interface of PreHashedFlatSet.
+    template <CombDeduplication Deduplication = CombDeduplication::CanonicalMultiset,
+        bool UseSortedPruning = false, std::uint32_t MaxCombSizeBits = 32,
+        typename TypeData = std::uint64_t, typename TypeCombTable = PreHashedFlatSet>
     static bool FindSumToTargetBackTracking(
         const InputSumToTargetDesc<TypeData>& inputDesc, std::string& errorStr);
+
+    // Back tracking of the same inputs for multiple targets, which builds the combs once with the
+    // smallest target rather than once per target, as the combs of a larger target are the ones
+    // of the smallest target whose remain values are still not less than it. All combs of each
+    // target are filtered out to outAllCombIndicesVecs, the same as FindSumToTargetBackTracking
+    // of each target with pOutAllCombIndicesVec.
+    template <CombDeduplication Deduplication = CombDeduplication::CanonicalMultiset,
+        bool UseSortedPruning = false, typename TypeData = std::uint64_t>
+    static bool FindSumToTargetsBackTracking(const std::vector<TypeData>& inputVec,
+        const std::vector<TypeData>& targetVec, std::uint64_t unitScale,
+        std::vector<std::vector<OutputCombination>>& outAllCombIndicesVecs,
+        float refMinExeedSum, std::string& errorStr);
+
+    // Max number of inputs of FindSumToTargetMeetInTheMiddle, and max number of inputs of a half
+    // whose subset sums are all kept in memory. Sums of a larger half are streamed from the sums of
+    // its two quarters instead.
+    static constexpr std::uint32_t k_maxMeetInTheMiddleInputSize = 48;
+    static constexpr std::uint32_t k_maxMeetInTheMiddleHalfSize  = 20;
+
+    // Meet in the middle solver which only outputs pOutClosestCombIndices: the subset sums of each
+    // half of the inputs are sorted, then merged by two pointers to find the smallest sum that is
+    // greater equal to the target. Sums are exact integers rather than floats. All indices are
+    // picked if the sum of all inputs can not finish the target.
+    template <typename TypeData = std::uint64_t>
+    static bool FindSumToTargetMeetInTheMiddle(
+        const InputSumToTargetDesc<TypeData>& inputDesc, std::string& errorStr);
+
+    // Max number of sums tracked by FindSumToTargetDynamicProgramming, which costs 1 bit for the
+    // reachability and 1 byte for the parent of each sum.
+    static constexpr std::uint64_t k_maxDynamicProgrammingSumSize = std::uint64_t(1) << 26;
+
+    // Number of sums FindSumToTargetDynamicProgramming needs to track for the inputs and target.
+    // Inputs and target are divided by the gcd of inputs, and the closest sum is always less than
+    // target + max input.
+    template <typename TypeData = std::uint64_t>
+    static std::uint64_t GetDynamicProgrammingSumSize(
+        const InputSumToTargetDesc<TypeData>& inputDesc);
+
+    // Dynamic programming solver which only outputs pOutClosestCombIndices: a bit array of
+    // reachable sums is shifted and or-ed by each input, and the input which reaches each sum first
+    // is recorded to reconstruct the smallest sum that is greater equal to the target. Sums are
+    // exact integers, and the cost only depends on GetDynamicProgrammingSumSize() * number of
+    // inputs. All indices are picked if the sum of all inputs can not finish the target.
+    template <typename TypeData = std::uint64_t>
+    static bool FindSumToTargetDynamicProgramming(
+        const InputSumToTargetDesc<TypeData>& inputDesc, std::string& errorStr);
+};
+
+// Parallel workers which keep running tasks until all of them are done, including the tasks pushed
+// by the running tasks. Each worker owns a deque, it runs the newest task of its own deque and
+// steals the oldest task of the others when it runs out, and is parked until a task is pushed if
+// there is none to steal. Running tasks should only split their remaining work into new tasks when
+// HasIdleWorkers(), to keep the overhead low.
+template <typename TypeTask>
+class WorkStealingScheduler
+{
+public:
+    struct WorkerStats
+    {
+        // Number of tasks run by the worker
+        std::size_t numTasks = 0;
+        // Number of tasks the worker stole from the others
+        std::size_t numStolenTasks = 0;
+        // Number of tasks pushed to the deque of the worker
+        std::size_t numPushedTasks = 0;
+    };
+
+    explicit WorkStealingScheduler(
+        std::uint32_t numWorkers = SelectCombination::GetNumParallelWorkers()) :
+        m_workers(numWorkers), m_workerStatsVec(numWorkers)
+    {
+    }
+
+    // Push a task to the deque of the worker, which is called by the worker itself while running
+    // or by anyone before Run.
+    void Push(std::uint32_t workerIndex, TypeTask task)
+    {
+        assert(workerIndex < m_workers.size());
+
+        ++m_numPendingTasks;
+        ++m_workerStatsVec[workerIndex].numPushedTasks;
+
+        {
+            auto& worker = m_workers[workerIndex];
+            std::lock_guard lock(worker.mutex);
+            worker.tasks.push_back(std::move(task));
+        }
+
+        // Idle workers are counted before they check the queued tasks, so one of them is either
+        // waiting for the notification or sees the task.
+        ++m_numQueuedTasks;
+        if (m_numIdleWorkers > 0)
+            notifyIdleWorkers(false);
+    }
+
+    bool HasIdleWorkers() const { return m_numIdleWorkers.load(std::memory_order_relaxed) > 0; }
+
+    // Call func(task, workerIndex) on the workers until no task is left.
+    template <typename TypeFunc>
+    void Run(TypeFunc&& func)
+    {
+        auto workerFunc = [&](std::uint32_t workerIndex) -> void {
+            auto& stats = m_workerStatsVec[workerIndex];
+            bool isIdle = false;
+            while (m_numPendingTasks > 0)
+            {
+                TypeTask task;
+                bool isStolen = false;
+                if (!popOwnTask(workerIndex, task))
+                {
+                    isStolen = stealTask(workerIndex, task);
+                    if (!isStolen)
+                    {
+                        if (!isIdle)
+                        {
+                            isIdle = true;
+                            ++m_numIdleWorkers;
+                        }
+
+                        std::unique_lock lock(m_idleMutex);
+                        m_idleCondition.wait(lock,
+                            [&] { return m_numQueuedTasks > 0 || m_numPendingTasks == 0; });
+                        continue;
+                    }
+                }
+
+                if (isIdle)
+                {
+                    isIdle = false;
+                    --m_numIdleWorkers;
+                }
+
+                func(task, workerIndex);
+
+                ++stats.numTasks;
+                if (isStolen)
+                    ++stats.numStolenTasks;
+
+                // Tasks pushed by this one are already pending.
+                if (--m_numPendingTasks == 0)
+                    notifyIdleWorkers(true);
+            }
+
+            if (isIdle)
+                --m_numIdleWorkers;
+        };
+
+        std::vector<std::thread> threadVec;
+        threadVec.reserve(m_workers.size());
+        for (std::uint32_t i = 0; i < m_workers.size(); ++i)
+            threadVec.emplace_back(workerFunc, i);
+
+        for (auto& thread : threadVec)
+            thread.join();
+    }
+
+    std::uint32_t GetNumWorkers() const { return static_cast<std::uint32_t>(m_workers.size()); }
+    const std::vector<WorkerStats>& GetWorkerStatsVec() const { return m_workerStatsVec; }
+
+private:
+    struct alignas(64) Worker
+    {
+        std::mutex mutex;
+        std::deque<TypeTask> tasks;
+    };
+
+    bool popOwnTask(std::uint32_t workerIndex, TypeTask& outTask)
+    {
+        auto& worker = m_workers[workerIndex];
+        std::lock_guard lock(worker.mutex);
+        if (worker.tasks.empty())
+            return false;
+
+        outTask = std::move(worker.tasks.back());
+        worker.tasks.pop_back();
+        --m_numQueuedTasks;
+        return true;
+    }
+
+    bool stealTask(std::uint32_t workerIndex, TypeTask& outTask)
+    {
+        const auto numWorkers = static_cast<std::uint32_t>(m_workers.size());
+        for (std::uint32_t i = 1; i < numWorkers; ++i)
+        {
+            auto& worker = m_workers[(workerIndex + i) % numWorkers];
+            std::lock_guard lock(worker.mutex);
+            if (worker.tasks.empty())
+                continue;
+
+            outTask = std::move(worker.tasks.front());
+            worker.tasks.pop_front();
+            --m_numQueuedTasks;
+            return true;
+        }
+        return false;
+    }
+
+    // The lock makes sure that a worker which has checked the condition is waiting before it is
+    // notified.
+    void notifyIdleWorkers(bool notifyAll)
+    {
+        {
+            std::lock_guard lock(m_idleMutex);
+        }
+        if (notifyAll)
+            m_idleCondition.notify_all();
+        else
+            m_idleCondition.notify_one();
+    }
+
+    std::vector<Worker> m_workers;
+    std::vector<WorkerStats> m_workerStatsVec;
+    std::atomic<std::size_t> m_numPendingTasks  = 0;
+    // Number of tasks in the deques, which are pushed but not taken yet
+    std::atomic<std::size_t> m_numQueuedTasks   = 0;
+    std::atomic<std::uint32_t> m_numIdleWorkers = 0;
+    std::mutex m_idleMutex;
+    std::condition_variable m_idleCondition;
 };
 
 } // namespace JUtils
\ No newline at end of file
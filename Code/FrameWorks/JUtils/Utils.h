@@ -8,11 +8,18 @@
 #include <functional>
 #include <iomanip>
 #include <locale>
+#include <memory>
+#include <new>
 #include <sstream>
 #include <string>
 #include <type_traits>
+#include <unordered_set>
 #include <vector>
 
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 template <typename EnumType, typename = typename std::enable_if_t<std::is_enum_v<EnumType>>>
 using TUnderLyingEnum = typename std::underlying_type<EnumType>::type;
 #define DEFINE_FLAG_ENUM_OPERATORS(ENUMTYPE)                                                       \
@@ -202,6 +209,44 @@ private:
     }
 };
 
+// Bit operations on 64 bits masks, std::countr_zero and std::popcount are not available until C++20.
+struct BitHelper
+{
+    // Number of trailing zero bits, value must not be 0.
+    static inline std::uint32_t CountTrailingZeros(std::uint64_t value)
+    {
+        assert(value != 0);
+#ifdef _MSC_VER
+        unsigned long index = 0;
+        _BitScanForward64(&index, value);
+        return static_cast<std::uint32_t>(index);
+#else
+        return static_cast<std::uint32_t>(__builtin_ctzll(value));
+#endif
+    }
+
+    static inline std::uint32_t PopCount(std::uint64_t value)
+    {
+#ifdef _MSC_VER
+        return static_cast<std::uint32_t>(__popcnt64(value));
+#else
+        return static_cast<std::uint32_t>(__builtin_popcountll(value));
+#endif
+    }
+
+    // Call func(bitIndex) for each set bit from the lowest one, only the set bits are visited.
+    template <typename TypeFunc>
+    static inline void ForEachSetBit(std::uint64_t mask, TypeFunc&& func)
+    {
+        while (mask != 0)
+        {
+            func(CountTrailingZeros(mask));
+            // Clear the lowest set bit
+            mask &= mask - 1;
+        }
+    }
+};
+
 // Helper to create recursive lambda
 template <typename T>
 struct LambdaCombinator
@@ -221,6 +266,235 @@ struct LambdaCombinator
 template <class T>
 LambdaCombinator(T) -> LambdaCombinator<T>;
 
+// Allocator aligning the storage to cache line, for the tables read in hot loops.
+template <typename T>
+struct CacheAlignedAllocator
+{
+    using value_type = T;
+
+    static constexpr std::size_t k_cacheLineSize = 64;
+
+    CacheAlignedAllocator() = default;
+    template <typename U>
+    CacheAlignedAllocator(const CacheAlignedAllocator<U>&)
+    {
+    }
+
+    T* allocate(std::size_t size)
+    {
+        return static_cast<T*>(
+            ::operator new(size * sizeof(T), std::align_val_t(k_cacheLineSize)));
+    }
+    void deallocate(T* ptr, std::size_t)
+    {
+        ::operator delete(ptr, std::align_val_t(k_cacheLineSize));
+    }
+
+    template <typename U>
+    bool operator==(const CacheAlignedAllocator<U>&) const
+    {
+        return true;
+    }
+    template <typename U>
+    bool operator!=(const CacheAlignedAllocator<U>&) const
+    {
+        return false;
+    }
+};
+template <typename T>
+using CacheAlignedVector = std::vector<T, CacheAlignedAllocator<T>>;
+
+// Append only storage of fixed size chunks, which never moves the stored elements and never copies
+// them to grow.
+template <typename T, std::uint32_t ChunkSizeBits = 12>
+class ChunkedArena
+{
+public:
+    static constexpr std::size_t k_chunkSize = std::size_t(1) << ChunkSizeBits;
+
+    template <typename... TypeArgs>
+    T& EmplaceBack(TypeArgs&&... args)
+    {
+        if ((m_size & (k_chunkSize - 1)) == 0)
+            m_chunks.emplace_back(std::make_unique<T[]>(k_chunkSize));
+
+        auto& out = m_chunks.back()[m_size & (k_chunkSize - 1)];
+        out       = T { std::forward<TypeArgs>(args)... };
+        ++m_size;
+        return out;
+    }
+
+    T& operator[](std::size_t index)
+    {
+        assert(index < m_size);
+        return m_chunks[index >> ChunkSizeBits][index & (k_chunkSize - 1)];
+    }
+    const T& operator[](std::size_t index) const
+    {
+        assert(index < m_size);
+        return m_chunks[index >> ChunkSizeBits][index & (k_chunkSize - 1)];
+    }
+
+    // Call func(element) in order of the elements.
+    template <typename TypeFunc>
+    void ForEach(TypeFunc&& func) const
+    {
+        for (std::size_t i = 0; i < m_size; ++i)
+            func(m_chunks[i >> ChunkSizeBits][i & (k_chunkSize - 1)]);
+    }
+
+    // Call func(element) in order of the elements, and release each chunk once all of its elements
+    // are visited. The arena is empty at the end.
+    template <typename TypeFunc>
+    void ConsumeEach(TypeFunc&& func)
+    {
+        for (std::size_t i = 0; i < m_size; ++i)
+        {
+            func(m_chunks[i >> ChunkSizeBits][i & (k_chunkSize - 1)]);
+            if (((i + 1) & (k_chunkSize - 1)) == 0)
+                m_chunks[i >> ChunkSizeBits].reset();
+        }
+        Clear();
+    }
+
+    std::size_t Size() const { return m_size; }
+    void Clear()
+    {
+        m_chunks.clear();
+        m_size = 0;
+    }
+
+    // New elements are not reset if they are in the chunks kept by a previous shrink. Elements can
+    // be written from multiple threads after resizing, as long as the indices are not the same.
+    void Resize(std::size_t size)
+    {
+        const auto numChunks = m_chunks.size();
+        m_chunks.resize((size + k_chunkSize - 1) >> ChunkSizeBits);
+        for (auto i = numChunks; i < m_chunks.size(); ++i)
+            m_chunks[i] = std::make_unique<T[]>(k_chunkSize);
+        m_size = size;
+    }
+
+private:
+    std::vector<std::unique_ptr<T[]>> m_chunks;
+    std::size_t m_size = 0;
+};
+
+// Open addressing set of keys that are already hashed, with linear probing in a flat array. The
+// load factor is kept under a half, reserving the expected size up front avoids any rehash.
+class PreHashedFlatSet
+{
+public:
+    void Reserve(std::size_t size)
+    {
+        std::size_t capacity = k_minCapacity;
+        while (capacity < size * 2)
+            capacity *= 2;
+        if (capacity > m_slots.size())
+            rehash(capacity);
+    }
+
+    bool Contains(std::size_t key) const
+    {
+        if (key == k_emptyKey)
+            return m_hasEmptyKey;
+        if (m_slots.empty())
+            return false;
+
+        for (auto slot = getSlot(key);; slot = (slot + 1) & m_slotMask)
+        {
+            if (m_slots[slot] == key)
+                return true;
+            if (m_slots[slot] == k_emptyKey)
+                return false;
+        }
+    }
+
+    // Returns true if the key is inserted, false if it already exists.
+    bool Insert(std::size_t key)
+    {
+        if (key == k_emptyKey)
+        {
+            if (m_hasEmptyKey)
+                return false;
+            m_hasEmptyKey = true;
+            ++m_size;
+            return true;
+        }
+
+        if ((m_size + 1) * 2 > m_slots.size())
+            rehash(std::max(k_minCapacity, m_slots.size() * 2));
+
+        for (auto slot = getSlot(key);; slot = (slot + 1) & m_slotMask)
+        {
+            if (m_slots[slot] == key)
+                return false;
+            if (m_slots[slot] == k_emptyKey)
+            {
+                m_slots[slot] = key;
+                ++m_size;
+                return true;
+            }
+        }
+    }
+
+    std::size_t Size() const { return m_size; }
+
+private:
+    // Key 0 marks empty slots, so that it is kept out of the slots.
+    static constexpr std::size_t k_emptyKey   = 0;
+    static constexpr std::size_t k_minCapacity = 16;
+
+    // Keys are hashed already, but the low bits are mixed once more since they pick the slot.
+    std::size_t getSlot(std::size_t key) const
+    {
+        return static_cast<std::size_t>(
+                   (static_cast<std::uint64_t>(key) * 0x9E3779B97F4A7C15ull) >> 32) &
+            m_slotMask;
+    }
+
+    void rehash(std::size_t capacity)
+    {
+        std::vector<std::size_t> oldSlots(capacity, k_emptyKey);
+        oldSlots.swap(m_slots);
+        m_slotMask = capacity - 1;
+        for (auto key : oldSlots)
+        {
+            if (key == k_emptyKey)
+                continue;
+
+            auto slot = getSlot(key);
+            while (m_slots[slot] != k_emptyKey)
+                slot = (slot + 1) & m_slotMask;
+            m_slots[slot] = key;
+        }
+    }
+
+    std::vector<std::size_t> m_slots;
+    std::size_t m_slotMask = 0;
+    std::size_t m_size     = 0;
+    bool m_hasEmptyKey     = false;
+};
+
+// Same interface as PreHashedFlatSet on top of std::unordered_set, which is the node based table
+// it replaces, kept to compare with.
+class PreHashedStdSet
+{
+public:
+    void Reserve(std::size_t size) { m_set.reserve(size); }
+    bool Contains(std::size_t key) const { return m_set.find(key) != m_set.end(); }
+    bool Insert(std::size_t key) { return m_set.insert(key).second; }
+    std::size_t Size() const { return m_set.size(); }
+
+private:
+    // Keys are hashed already.
+    struct Hasher
+    {
+        std::size_t operator()(const std::size_t& value) const { return value; }
+    };
+    std::unordered_set<std::size_t, Hasher, std::equal_to<std::size_t>> m_set;
+};
+
 class Timer
 {
 public:
@@ -5,16 +5,41 @@
 #include "JUtils/pch.h"
 
 #include "GearCalculator.h"
+#include "XianRenPropKernel.h"
 
 #include "JUtils/Algorithms.h"
 #include "JUtils/Utils.h"
 
+#include <cstring>
 #include <execution>
 #include <mutex>
+#include <random>
 #include <unordered_set>
 
 #include "vorbrodt/pool.hpp"
 
+// Update the gear buffs of previous comb by one removed and one added gear of revolving door
+// order, instead of accumulating all the gears of each comb. It is much faster, but subtracting
+// the percent buffs in floating point is not exact, so that the final props might be off by one
+// comparing to accumulating from scratch. Fixed point buff arithmetic rounds the percents to basis
+// points, which is exact either way. So while this is false, the revolving door engine only runs
+// with BuffArithmetic::FixedPoint, and floating point accumulates each comb from scratch.
+// It only applies to the chan ye selectors, and to the xian ren selectors while
+// USE_BRANCH_AND_BOUND_FOR_XIANREN_SELECTION is false, since branch and bound accumulates the
+// buffs along its own search tree.
+#define USE_REVOLVING_DOOR_FOR_GEAR_SELECTION false
+
+// Cut the partial combs of xian ren solutions which can never beat the best one found so far.
+#define USE_BRANCH_AND_BOUND_FOR_XIANREN_SELECTION true
+
+// Apply gear buffs to 4 xian ren at once with AVX2 when the CPU supports it. The results are bit
+// exact to the scalar path, turn it off only to compare.
+#define USE_SIMD_FOR_XIANREN_PROP_KERNEL true
+
+// Drop the gears dominated by at least as many other gears as can be equipped before enumerating
+// the combs, since one of the dominating gears can always replace it without lowering the score.
+#define USE_DOMINANCE_FILTER_FOR_GEARS true
+
 using namespace JUtils;
 using namespace GearCalc;
 
@@ -129,12 +154,12 @@ template <ChanyeFieldCategory::Enum ChanyeCat,
     typename = std::enable_if_t<ChanyeCat == ChanyeFieldCategory::ChanJing ||
         ChanyeCat == ChanyeFieldCategory::ChanNeng>>
 void GetChanyeProp(const XianRenProp& xianRenPropSum, const ChanyeFieldData& chanyeData,
-    const ChanyePropBuff& allChanyeBuffs, ChanyeProp<ChanyeCat>& out)
+    const ChanyePropBuff& allChanyeBuffs, BuffArithmetic arithmetic, ChanyeProp<ChanyeCat>& out)
 {
     // Base output
-    out.output = chanyeData.CalcBaseOutput(xianRenPropSum);
+    out.output = chanyeData.CalcBaseOutput(xianRenPropSum, arithmetic);
     // Apply chanye buffs
-    out.ApplyBuff(allChanyeBuffs);
+    out.ApplyBuff(allChanyeBuffs, arithmetic);
 }
 } // namespace GameAlgorithms
 
@@ -147,19 +172,361 @@ void PrintSmallSpace()
     std::cout << "-----------------------------------------" << std::endl;
 }
 
+// Bounded min heap of the best combs, only the score and the bit mask of each comb are kept so
+// that it is cheap to update, the details of the winners are computed again afterward. Each worker
+// owns one and they are merged at the end.
+template <typename TypeScore>
+class TopCombs
+{
+public:
+    struct Entry
+    {
+        TypeScore score;
+        std::uint64_t combMask;
+    };
+
+    explicit TopCombs(std::size_t maxNumCombs = 1) : m_maxNumCombs(maxNumCombs)
+    {
+        assert(maxNumCombs > 0);
+        m_heap.reserve(maxNumCombs);
+    }
+
+    // Returns true if a is better than b. Lexicographic earliest comb wins on ties, so that results
+    // are the same as single thread solution.
+    static bool IsBetter(const Entry& a, const Entry& b)
+    {
+        if (a.score != b.score)
+            return a.score > b.score;
+        return SelectCombination::IsBitMaskCombLexLess(a.combMask, b.combMask);
+    }
+
+    // Returns true if the comb is kept, the worst one is dropped when it is full.
+    bool Insert(TypeScore score, std::uint64_t combMask)
+    {
+        Entry entry { score, combMask };
+        if (m_heap.size() < m_maxNumCombs)
+        {
+            m_heap.emplace_back(entry);
+            std::push_heap(m_heap.begin(), m_heap.end(), IsBetter);
+            return true;
+        }
+
+        if (!IsBetter(entry, m_heap.front()))
+            return false;
+
+        std::pop_heap(m_heap.begin(), m_heap.end(), IsBetter);
+        m_heap.back() = entry;
+        std::push_heap(m_heap.begin(), m_heap.end(), IsBetter);
+        return true;
+    }
+
+    void Merge(const TopCombs& other)
+    {
+        for (const auto& entry : other.m_heap)
+            Insert(entry.score, entry.combMask);
+    }
+
+    bool IsEmpty() const { return m_heap.empty(); }
+    bool IsFull() const { return m_heap.size() == m_maxNumCombs; }
+
+    // Score of the worst kept comb, others need to be at least as good to get in when it is full.
+    TypeScore GetWorstScore() const { return m_heap.front().score; }
+
+    // Kept combs from the best one to the worst one.
+    std::vector<Entry> GetSortedCombs() const
+    {
+        auto out = m_heap;
+        std::sort(out.begin(), out.end(), IsBetter);
+        return out;
+    }
+
+private:
+    std::size_t m_maxNumCombs;
+
+    // The worst one is at the front
+    std::vector<Entry> m_heap;
+};
+
+// Merge the top combs of all workers.
+template <typename TypeWorkerState>
+auto MergeWorkerTopCombs(const std::vector<TypeWorkerState>& workerStateVec)
+{
+    assert(!workerStateVec.empty());
+
+    auto out = workerStateVec.front().topCombs;
+    for (std::size_t i = 1; i < workerStateVec.size(); ++i)
+        out.Merge(workerStateVec[i].topCombs);
+    return out;
+}
+
+// Raise the shared threshold to the worst score of a full top combs, combs can not be among the
+// final top ones if they are worse than it.
+template <typename TypeScore>
+void RaiseTopCombsThreshold(std::atomic<TypeScore>& threshold, const TopCombs<TypeScore>& topCombs)
+{
+    if (!topCombs.IsFull())
+        return;
+
+    auto worstScore = topCombs.GetWorstScore();
+    auto current    = threshold.load(std::memory_order_relaxed);
+    while (current < worstScore &&
+        !threshold.compare_exchange_weak(current, worstScore, std::memory_order_relaxed))
+    {
+    }
+}
+
+// Run the gear combs with the engine configured by USE_REVOLVING_DOOR_FOR_GEAR_SELECTION and the
+// buff arithmetic. callBack(mask, removedIndex, addedIndex, workerIndex), removedIndex and
+// addedIndex are SelectCombination::k_revolvingDoorNoChange when all the gears of mask must be
+// accumulated.
+template <typename TypeCallBack>
+std::size_t RunGearCombs(std::size_t numGears, std::size_t numEquip, BuffArithmetic arithmetic,
+    TypeCallBack&& callBack)
+{
+    if (USE_REVOLVING_DOOR_FOR_GEAR_SELECTION || arithmetic == BuffArithmetic::FixedPoint)
+    {
+        return SelectCombination::RunRevolvingDoorParallel(numGears, numEquip,
+            [&](std::uint64_t combMask, std::uint32_t removedIndex, std::uint32_t addedIndex,
+                std::size_t, std::uint32_t workerIndex) {
+                callBack(combMask, removedIndex, addedIndex, workerIndex);
+            });
+    }
+
+    return SelectCombination::RunBitMaskParallel(numGears, numEquip,
+        [&](std::uint64_t combMask, std::size_t, std::uint32_t workerIndex) {
+            callBack(combMask, SelectCombination::k_revolvingDoorNoChange,
+                SelectCombination::k_revolvingDoorNoChange, workerIndex);
+        });
+}
+
+// Gear buffs of a comb used by xian ren solutions.
+struct XianRenGearBuffs
+{
+    XianRenPropBuff individual;
+    XianRenPropBuff global;
+};
+
+// Upper bound of gear buffs gained by picking numPicks gears from [gearIndex, gears.size()), it is
+// stored at [gearIndex][numPicks]. Each buff field is the sum of its largest numPicks values, which
+// is not less than the one of any picked gears.
+template <XianRenPropertyMask PropMask>
+std::vector<std::vector<XianRenGearBuffs>> GetTopGearBuffsTable(
+    const std::vector<const GearData*>& gears, std::size_t maxNumPicks)
+{
+    // Percents are enlarged slightly to cover the rounding of different accumulating orders.
+    static constexpr double kPercentMargin = 1e-6;
+
+    const auto numGears = gears.size();
+    std::vector<std::vector<XianRenGearBuffs>> out(
+        numGears + 1, std::vector<XianRenGearBuffs>(maxNumPicks + 1));
+
+    auto fillField = [&](XianRenPropBuff GearData::*pGearBuff,
+                         XianRenPropBuff XianRenGearBuffs::*pOutBuff, auto pField) -> void {
+        using TypeValue = std::remove_reference_t<decltype(XianRenPropBuff().*pField)>;
+
+        std::vector<TypeValue> values;
+        values.reserve(numGears);
+        for (auto gearIndex = numGears; gearIndex-- > 0;)
+        {
+            values.emplace_back(gears[gearIndex]->*pGearBuff.*pField);
+            std::sort(values.begin(), values.end(), std::greater<TypeValue>());
+
+            TypeValue sum = 0;
+            for (std::size_t numPicks = 1; numPicks <= maxNumPicks; ++numPicks)
+            {
+                if (numPicks <= values.size())
+                    sum += values[numPicks - 1];
+
+                if constexpr (std::is_floating_point_v<TypeValue>)
+                    (out[gearIndex][numPicks].*pOutBuff).*pField = sum + kPercentMargin;
+                else
+                    (out[gearIndex][numPicks].*pOutBuff).*pField = sum;
+            }
+        }
+    };
+
+    for (auto [pGearBuff, pOutBuff] :
+        { std::make_pair(&GearData::individualBuff, &XianRenGearBuffs::individual),
+            std::make_pair(&GearData::globalBuff, &XianRenGearBuffs::global) })
+    {
+        if constexpr ((PropMask & XianRenPropertyMask::Li) != XianRenPropertyMask::None)
+        {
+            fillField(pGearBuff, pOutBuff, &XianRenPropBuff::li_add);
+            fillField(pGearBuff, pOutBuff, &XianRenPropBuff::li_percent);
+        }
+        if constexpr ((PropMask & XianRenPropertyMask::Nian) != XianRenPropertyMask::None)
+        {
+            fillField(pGearBuff, pOutBuff, &XianRenPropBuff::nian_add);
+            fillField(pGearBuff, pOutBuff, &XianRenPropBuff::nian_percent);
+        }
+        if constexpr ((PropMask & XianRenPropertyMask::Fu) != XianRenPropertyMask::None)
+        {
+            fillField(pGearBuff, pOutBuff, &XianRenPropBuff::fu_add);
+            fillField(pGearBuff, pOutBuff, &XianRenPropBuff::fu_percent);
+        }
+    }
+
+    return out;
+}
+
+// Props only grow with buffs as long as nothing is negative, which the bounds of branch and bound
+// rely on.
+bool IsNotNegative(const XianRenPropBuff& buff)
+{
+    return buff.li_percent >= 0.0 && buff.nian_percent >= 0.0 && buff.fu_percent >= 0.0;
+}
+bool IsNotNegative(const XianRenProp& prop)
+{
+    return prop.li >= 0.0 && prop.nian >= 0.0 && prop.fu >= 0.0;
+}
+bool IsNotNegative(const ChanyePropBuff& buff)
+{
+    return buff.chanJing_percent >= 0.0 && buff.chanNeng_percent >= 0.0;
+}
+
+// Returns true if every buff field of the mask in a is not less than the one in b.
+template <XianRenPropertyMask PropMask>
+bool IsNotLess(const XianRenPropBuff& a, const XianRenPropBuff& b)
+{
+    bool out = true;
+    if constexpr ((PropMask & XianRenPropertyMask::Li) != XianRenPropertyMask::None)
+        out = out && a.li_add >= b.li_add && a.li_percent >= b.li_percent;
+    if constexpr ((PropMask & XianRenPropertyMask::Nian) != XianRenPropertyMask::None)
+        out = out && a.nian_add >= b.nian_add && a.nian_percent >= b.nian_percent;
+    if constexpr ((PropMask & XianRenPropertyMask::Fu) != XianRenPropertyMask::None)
+        out = out && a.fu_add >= b.fu_add && a.fu_percent >= b.fu_percent;
+    return out;
+}
+template <ChanyePropertyMask PropMask>
+bool IsNotLess(const ChanyePropBuff& a, const ChanyePropBuff& b)
+{
+    bool out = true;
+    if constexpr ((PropMask & ChanyePropertyMask::ChanJing) != ChanyePropertyMask::None)
+        out = out && a.chanJing_add >= b.chanJing_add && a.chanJing_percent >= b.chanJing_percent;
+    if constexpr ((PropMask & ChanyePropertyMask::ChanNeng) != ChanyePropertyMask::None)
+        out = out && a.chanNeng_add >= b.chanNeng_add && a.chanNeng_percent >= b.chanNeng_percent;
+    return out;
+}
+
+// Returns the indices of the gears which are dominated by at least numEquip other gears.
+// isNotLess(a, b) returns true if all the buffs of gear a used by the solution are not less than
+// the ones of gear b. As long as the score never drops with more buffs, any comb with a dominated
+// gear can swap it for one of the dominating gears not in the comb, so that the best comb never
+// needs it. Identical gears are only dominated by the earlier ones, so that one of them is kept.
+template <typename TypeIsNotLess>
+std::vector<std::uint32_t> GetDominatedGears(
+    std::size_t numGears, std::size_t numEquip, TypeIsNotLess&& isNotLess)
+{
+    std::vector<std::uint32_t> out;
+    for (std::uint32_t gearIndex = 0; gearIndex < numGears; ++gearIndex)
+    {
+        std::size_t numDominating = 0;
+        for (std::uint32_t otherIndex = 0; otherIndex < numGears && numDominating < numEquip;
+             ++otherIndex)
+        {
+            if (otherIndex == gearIndex || !isNotLess(otherIndex, gearIndex))
+                continue;
+
+            // Identical to the gear, and it is the later one.
+            if (otherIndex > gearIndex && isNotLess(gearIndex, otherIndex))
+                continue;
+
+            ++numDominating;
+        }
+
+        if (numDominating >= numEquip)
+            out.emplace_back(gearIndex);
+    }
+    return out;
+}
+
+// Tables built once by Calculator::Run before running any solution. The per comb path reads these
+// contiguous tables by the index of gear or xian ren, instead of following the pointers into the
+// parsed data and deriving the static buffs again.
+// Buffs of each gear, in order of the gears.
+struct GearTables
+{
+    void Init(const std::vector<const GearData*>& gearVec)
+    {
+        gears = gearVec;
+        individualBuffs.resize(gears.size());
+        globalBuffs.resize(gears.size());
+        chanyeBuffs.resize(gears.size());
+        for (std::size_t i = 0; i < gears.size(); ++i)
+        {
+            individualBuffs[i] = gears[i]->individualBuff;
+            globalBuffs[i]     = gears[i]->globalBuff;
+            chanyeBuffs[i]     = gears[i]->chanyeBuff;
+        }
+    }
+
+    // Tables of the gears at given indices only, in the given order.
+    GearTables Select(const std::vector<std::uint32_t>& gearIndices) const
+    {
+        GearTables out;
+        out.gears.reserve(gearIndices.size());
+        out.individualBuffs.reserve(gearIndices.size());
+        out.globalBuffs.reserve(gearIndices.size());
+        out.chanyeBuffs.reserve(gearIndices.size());
+        for (auto gearIndex : gearIndices)
+        {
+            out.gears.emplace_back(gears[gearIndex]);
+            out.individualBuffs.emplace_back(individualBuffs[gearIndex]);
+            out.globalBuffs.emplace_back(globalBuffs[gearIndex]);
+            out.chanyeBuffs.emplace_back(chanyeBuffs[gearIndex]);
+        }
+        return out;
+    }
+
+    std::vector<const GearData*> gears;
+    CacheAlignedVector<XianRenPropBuff> individualBuffs;
+    CacheAlignedVector<XianRenPropBuff> globalBuffs;
+    CacheAlignedVector<ChanyePropBuff> chanyeBuffs;
+};
+
+struct CalcTables
+{
+    void Init(const XianJieFileData& xianJieFileData, const XianQiFileData& xianQiFileData)
+    {
+        gearTables.Init(xianQiFileData.GetCalcGearsVec());
+
+        const auto& xianRenVec = xianJieFileData.GetCalcXianRenDataVec();
+        xianRenBaseProps.resize(xianRenVec.size());
+        for (std::size_t i = 0; i < xianRenVec.size(); ++i)
+            xianRenBaseProps[i] = xianRenVec[i]->baseProp;
+
+        // All props are kept, solutions only read the ones of their masks.
+        xianRenStaticBuffs = GameAlgorithms::GetXianRenStaicBuffVec(xianJieFileData, xianRenVec,
+            [](auto& element) -> const XianRenData& { return *element; });
+
+        xianRenPropKernel.Init(xianRenBaseProps, xianRenStaticBuffs,
+            xianQiFileData.GetBuffArithmetic(), USE_SIMD_FOR_XIANREN_PROP_KERNEL);
+    }
+
+    // Buffs of each gear, in order of XianQiFileData::GetCalcGearsVec()
+    GearTables gearTables;
+
+    // Base props and static buffs (xianzhi + fushi + global) of each xian ren, in order of
+    // XianJieFileData::GetCalcXianRenDataVec()
+    std::vector<XianRenProp> xianRenBaseProps;
+    std::vector<XianRenPropBuff> xianRenStaticBuffs;
+    XianRenPropKernel xianRenPropKernel;
+};
+
 struct SolutionSelectorBase
 {
     template <typename ThisType,
         typename = typename std::enable_if_t<std::is_base_of_v<SolutionSelectorBase, ThisType>>>
-    static std::unique_ptr<ThisType> CreateInstance(
-        const XianJieFileData& xianJieFileData, const XianQiFileData& xianQiFileData)
+    static std::unique_ptr<ThisType> CreateInstance(const XianJieFileData& xianJieFileData,
+        const XianQiFileData& xianQiFileData, const CalcTables& calcTables)
     {
-        return std::make_unique<ThisType>(xianJieFileData, xianQiFileData);
+        return std::make_unique<ThisType>(xianJieFileData, xianQiFileData, calcTables);
     }
 
-    SolutionSelectorBase(
-        const XianJieFileData& xianJieFileData, const XianQiFileData& xianQiFileData) :
-        m_xianJieFileData(xianJieFileData), m_xianQiFileData(xianQiFileData)
+    SolutionSelectorBase(const XianJieFileData& xianJieFileData,
+        const XianQiFileData& xianQiFileData, const CalcTables& calcTables) :
+        m_xianJieFileData(xianJieFileData),
+        m_xianQiFileData(xianQiFileData), m_calcTables(calcTables)
     {
     }
 
@@ -167,8 +534,46 @@ struct SolutionSelectorBase
     virtual bool Run(std::string& errorStr) = 0;
 
 protected:
+    // Gear tables of the gears to enumerate, the dominated ones are dropped and printed if
+    // canFilter, see GetDominatedGears().
+    template <typename TypeIsNotLess>
+    GearTables SelectGears(bool canFilter, TypeIsNotLess&& isNotLess) const
+    {
+        const auto& allGearTables = m_calcTables.gearTables;
+        const auto numGears       = allGearTables.gears.size();
+        const auto maxEquiptNum   = m_xianQiFileData.GetMaxNumEquip();
+
+        std::vector<std::uint32_t> droppedGears;
+        if (USE_DOMINANCE_FILTER_FOR_GEARS && canFilter && maxEquiptNum > 0)
+        {
+            droppedGears = GetDominatedGears(numGears, maxEquiptNum,
+                [&](std::uint32_t a, std::uint32_t b) { return isNotLess(allGearTables, a, b); });
+        }
+
+        if (!droppedGears.empty())
+        {
+            std::cout << u8"以下仙器被至少" << maxEquiptNum << u8"件其他仙器全面超越, 不参与计算:"
+                      << std::endl;
+            for (auto gearIndex : droppedGears)
+                std::cout << allGearTables.gears[gearIndex]->name << std::endl;
+            PrintSmallSpace();
+        }
+
+        std::vector<std::uint32_t> keptGears;
+        keptGears.reserve(numGears - droppedGears.size());
+        for (std::uint32_t gearIndex = 0, droppedIndex = 0; gearIndex < numGears; ++gearIndex)
+        {
+            if (droppedIndex < droppedGears.size() && droppedGears[droppedIndex] == gearIndex)
+                ++droppedIndex;
+            else
+                keptGears.emplace_back(gearIndex);
+        }
+        return allGearTables.Select(keptGears);
+    }
+
     const XianJieFileData& m_xianJieFileData;
     const XianQiFileData& m_xianQiFileData;
+    const CalcTables& m_calcTables;
 };
 
 template <Calculator::Solution SolutionType,
@@ -177,9 +582,9 @@ template <Calculator::Solution SolutionType,
 struct XianRenGearSelector : public SolutionSelectorBase
 {
 public:
-    XianRenGearSelector(
-        const XianJieFileData& xianJieFileData, const XianQiFileData& xianQiFileData) :
-        SolutionSelectorBase(xianJieFileData, xianQiFileData)
+    XianRenGearSelector(const XianJieFileData& xianJieFileData,
+        const XianQiFileData& xianQiFileData, const CalcTables& calcTables) :
+        SolutionSelectorBase(xianJieFileData, xianQiFileData, calcTables)
     {
     }
 
@@ -187,10 +592,9 @@ public:
     {
         const auto& xianRenVec = m_xianJieFileData.GetCalcXianRenDataVec();
 
-        const auto& xianQiVec     = m_xianQiFileData.GetCalcGearsVec();
         const auto xianRenVecSize = xianRenVec.size();
-        const auto xianQiVecSize  = xianQiVec.size();
         const auto maxEquiptNum   = m_xianQiFileData.GetMaxNumEquip();
+        const auto buffArithmetic = m_xianQiFileData.GetBuffArithmetic();
 
         // Config prop mask
         static constexpr auto kXianRenPropMask = []() -> XianRenPropertyMask {
@@ -199,6 +603,44 @@ public:
             else
                 return XianRenPropertyMask::Li | XianRenPropertyMask::Nian;
         }();
+        static constexpr bool kUseGlobalBuffs =
+            SolutionType == Calculator::Solution::BestGlobalSumLiNian;
+
+        // Xian ren static buff vec (global + self ) and the kernel to apply gear buffs to all of
+        // them at once
+        const auto& xianRenStaticBuffVec = m_calcTables.xianRenStaticBuffs;
+        const auto& xianRenPropKernel    = m_calcTables.xianRenPropKernel;
+
+        // Init xian ren self buff vec
+        XianRenPropBuff xianJie_global_Buff;
+        GameAlgorithms::GetSumOfXianjieGlobalBuffs(m_xianJieFileData, xianJie_global_Buff);
+
+        // More buffs never lower the score as long as all props and buffs are not negative.
+        bool isNotNegative = IsNotNegative(xianJie_global_Buff);
+        for (int i = 0; i < xianRenVecSize; ++i)
+        {
+            isNotNegative = isNotNegative && IsNotNegative(xianRenVec[i]->baseProp) &&
+                IsNotNegative(xianRenStaticBuffVec[i]);
+        }
+        for (const auto* pXianQi : m_calcTables.gearTables.gears)
+        {
+            isNotNegative = isNotNegative && IsNotNegative(pXianQi->individualBuff) &&
+                IsNotNegative(pXianQi->globalBuff);
+        }
+
+        // Dominated gears can be dropped only when a single best comb is wanted, since they may
+        // still be in the other top combs.
+        const auto gearTables = SelectGears(isNotNegative &&
+                m_xianQiFileData.GetNumOutputCombs() == 1,
+            [](const GearTables& tables, std::uint32_t a, std::uint32_t b) -> bool {
+                if (!IsNotLess<kXianRenPropMask>(
+                        tables.individualBuffs[a], tables.individualBuffs[b]))
+                    return false;
+                return !kUseGlobalBuffs ||
+                    IsNotLess<kXianRenPropMask>(tables.globalBuffs[a], tables.globalBuffs[b]);
+            });
+        const auto& xianQiVec    = gearTables.gears;
+        const auto xianQiVecSize = xianQiVec.size();
 
         if (maxEquiptNum < 1)
         {
@@ -206,11 +648,22 @@ public:
             assert(false);
             return false;
         }
+        if (xianQiVecSize > PickIndex::k_maxInputSize)
+        {
+            errorStr += FormatString(u8"参与计算的仙器数不能超过", PickIndex::k_maxInputSize,
+                u8"个, 当前为: ", xianQiVecSize, "\n");
+            assert(false);
+            return false;
+        }
         const auto expectedCombSize =
             SelectCombination::GetNumOfSelectionComb(xianQiVecSize, maxEquiptNum);
         std::cout << u8"需计算仙人数: " << xianRenVecSize << std::endl;
         std::cout << u8"需计算仙器数: " << xianQiVecSize << std::endl;
         std::cout << u8"可装备个数: " << maxEquiptNum << std::endl;
+        if (m_xianQiFileData.GetNumOutputCombs() > 1)
+            std::cout << u8"输出组合个数: " << m_xianQiFileData.GetNumOutputCombs() << std::endl;
+        if (buffArithmetic == BuffArithmetic::FixedPoint)
+            std::cout << u8"使用定点数计算" << std::endl;
         std::cout << u8"需计算: " << FormatNumber(expectedCombSize) << u8" 种可能性" << std::endl;
         PrintLargeSpace();
 
@@ -220,130 +673,166 @@ public:
             return false;
         }
 
-        // Init xian ren static buff vec (global + self )
-        const std::vector<XianRenPropBuff> xianRenStaticBuffVec =
-            GameAlgorithms::GetXianRenStaicBuffVec<kXianRenPropMask>(m_xianJieFileData, xianRenVec,
-                [](auto& element) -> const XianRenData& { return *element; });
-
-        // Init xian ren self buff vec
-        XianRenPropBuff xianJie_global_Buff;
-        GameAlgorithms::GetSumOfXianjieGlobalBuffs(m_xianJieFileData, xianJie_global_Buff);
-
-        // Best ones
-        using CombVecType = std::vector<std::size_t>;
-        CombVecType bestComb;
-        XianRenProp best_xianren_prop_sum;
-        double best_xianren_individual_sum_num = 0.0;
-        double best_global_li_nian_sum_num     = 0.0;
-        std::vector<XianRenProp> bestXianRenFinalPropVec;
-
-        std::vector<XianRenProp> xianRenFinalPropStack(xianRenVecSize);
-        auto combCallBack = [&](const CombVecType& combIndexVec, std::size_t indexOfComb) -> void {
-            if constexpr (SolutionType == Calculator::Solution::BestXianRenSumProp)
+        // Sum of final props of all xian ren with given gear buffs, the final prop of each xian
+        // ren is written to pXianRenFinalProps if it is not null.
+        auto getXianRenPropSum = [&](const XianRenGearBuffs& gearBuffs,
+                                     XianRenProp* pXianRenFinalProps) -> XianRenProp {
+            // Apply all individual buffs to each Xian Ren
+            XianRenProp sumXianRenProp;
+            if (pXianRenFinalProps == nullptr)
+            {
+                sumXianRenProp = xianRenPropKernel.ApplyBuffAndSum<kXianRenPropMask>(
+                    gearBuffs.individual, 0, xianRenVecSize);
+            }
+            else
             {
-
-                // Accomulate individual buff of each Xian Qi
-                XianRenPropBuff xianQi_individual_buff;
-                for (auto& combIndex : combIndexVec)
-                {
-                    xianQi_individual_buff.IncreaseBy<kXianRenPropMask>(
-                        xianQiVec[combIndex]->individualBuff);
-                }
-
-                // Apply all individual buffs to each Xian Ren
-                XianRenProp sumXianRenProp;
                 for (int i = 0; i < xianRenVecSize; ++i)
                 {
-                    const auto* pXianRenData = xianRenVec[i];
-
                     // All buffs.
                     auto allBuffs =
-                        xianQi_individual_buff.Add<kXianRenPropMask>(xianRenStaticBuffVec[i]);
+                        gearBuffs.individual.Add<kXianRenPropMask>(xianRenStaticBuffVec[i]);
 
                     // Apply all buffs to xian ren.
-                    auto& xianRenPropCopy = xianRenFinalPropStack[i];
-                    xianRenPropCopy       = pXianRenData->baseProp;
-                    xianRenPropCopy.ApplyBuff<kXianRenPropMask>(allBuffs);
+                    XianRenProp& xianRenPropCopy = pXianRenFinalProps[i];
+                    xianRenPropCopy              = m_calcTables.xianRenBaseProps[i];
+                    xianRenPropCopy.ApplyBuff<kXianRenPropMask>(allBuffs, buffArithmetic);
 
                     // Accomulate the sum.
                     sumXianRenProp.IncreaseBy<kXianRenPropMask>(xianRenPropCopy);
                 }
+            }
 
-                // Select the best one
-                {
-                    auto sum = sumXianRenProp.GetSum();
-                    if (sum > best_xianren_individual_sum_num)
-                    {
-                        bestComb                        = combIndexVec;
-                        best_xianren_prop_sum           = sumXianRenProp;
-                        best_xianren_individual_sum_num = sum;
-
-                        bestXianRenFinalPropVec = xianRenFinalPropStack;
-                    }
-                }
+            if constexpr (kUseGlobalBuffs)
+            {
+                // Apply all global buffs to final sum of each xianren prop
+                auto all_global_buffs = gearBuffs.global.Add<kXianRenPropMask>(xianJie_global_Buff);
+                sumXianRenProp.ApplyBuff<kXianRenPropMask>(all_global_buffs, buffArithmetic);
+            }
+            return sumXianRenProp;
+        };
+        auto getScore = [](const XianRenProp& sumXianRenProp) -> double {
+            if constexpr (SolutionType == Calculator::Solution::BestXianRenSumProp)
+            {
+                return sumXianRenProp.GetSum();
             }
             else if constexpr (SolutionType == Calculator::Solution::BestGlobalSumLiNian)
             {
-                // Accomulate individual & global buffs of each Xian Qi
-                XianRenPropBuff xianQi_individual_buff;
-                XianRenPropBuff all_global_buffs;
-                for (auto& combIndex : combIndexVec)
-                {
-                    const auto& xianQi = xianQiVec[combIndex];
+                return sumXianRenProp.li + sumXianRenProp.nian;
+            }
+            else
+            {
+                static_assert(false);
+            }
+        };
 
-                    xianQi_individual_buff.IncreaseBy<kXianRenPropMask>(xianQi->individualBuff);
-                    all_global_buffs.IncreaseBy<kXianRenPropMask>(xianQi->globalBuff);
-                }
-                all_global_buffs.IncreaseBy<kXianRenPropMask>(xianJie_global_Buff);
+        // Accomulate individual (& global) buffs of a Xian Qi
+        const auto& gearIndividualBuffs = gearTables.individualBuffs;
+        const auto& gearGlobalBuffs     = gearTables.globalBuffs;
+        auto increaseGearBuffs = [&](XianRenGearBuffs& gearBuffs, std::size_t gearIndex) -> void {
+            gearBuffs.individual.IncreaseBy<kXianRenPropMask>(gearIndividualBuffs[gearIndex]);
+            if constexpr (kUseGlobalBuffs)
+                gearBuffs.global.IncreaseBy<kXianRenPropMask>(gearGlobalBuffs[gearIndex]);
+        };
+#if !USE_BRANCH_AND_BOUND_FOR_XIANREN_SELECTION
+        auto decreaseGearBuffs = [&](XianRenGearBuffs& gearBuffs, std::size_t gearIndex) -> void {
+            gearBuffs.individual.DecreaseBy<kXianRenPropMask>(gearIndividualBuffs[gearIndex]);
+            if constexpr (kUseGlobalBuffs)
+                gearBuffs.global.DecreaseBy<kXianRenPropMask>(gearGlobalBuffs[gearIndex]);
+        };
+#endif
+
+        // Gear buffs of a comb, which are accumulated in ascending order of gears.
+        auto getGearBuffs = [&](std::uint64_t combMask) -> XianRenGearBuffs {
+            XianRenGearBuffs gearBuffs;
+            BitHelper::ForEachSetBit(
+                combMask, [&](std::uint32_t combIndex) { increaseGearBuffs(gearBuffs, combIndex); });
+            return gearBuffs;
+        };
 
-                // Apply all individual buffs to each Xian Ren
-                XianRenProp sumXianRenProp;
-                for (int i = 0; i < xianRenVecSize; ++i)
-                {
-                    const auto* pXianRenData = xianRenVec[i];
+        // States of each worker, every worker owns its states to avoid any data race.
+        struct WorkerState
+        {
+            explicit WorkerState(std::size_t maxNumCombs) : topCombs(maxNumCombs) {}
 
-                    // All buffs.
-                    auto allBuffs =
-                        xianQi_individual_buff.Add<kXianRenPropMask>(xianRenStaticBuffVec[i]);
+            TopCombs<double> topCombs;
 
-                    // Apply all buffs to xian ren.
-                    auto& xianRenPropCopy = xianRenFinalPropStack[i];
-                    xianRenPropCopy       = pXianRenData->baseProp;
-                    xianRenPropCopy.ApplyBuff<kXianRenPropMask>(allBuffs);
+            // Gear buffs of current comb
+            XianRenGearBuffs gearBuffs;
+        };
+        const std::size_t numOutputCombs = m_xianQiFileData.GetNumOutputCombs();
+        std::vector<WorkerState> workerStateVec(
+            SelectCombination::GetNumParallelWorkers(), WorkerState(numOutputCombs));
+
+        // Worst score of the top combs of all workers, which is used to prune.
+        std::atomic<double> topCombsThreshold = std::numeric_limits<double>::lowest();
+
+        // Evaluate the comb with given gear buffs, and keep it if it is one of the top combs of the
+        // worker.
+        auto evaluateComb = [&](const XianRenGearBuffs& gearBuffs, std::uint64_t combMask,
+                                std::uint32_t workerIndex) -> void {
+            auto& topCombs = workerStateVec[workerIndex].topCombs;
+
+            auto sum = getScore(getXianRenPropSum(gearBuffs, nullptr));
+            if (topCombs.Insert(sum, combMask))
+                RaiseTopCombsThreshold(topCombsThreshold, topCombs);
+        };
 
-                    // Accomulate the sum.
-                    sumXianRenProp.IncreaseBy<kXianRenPropMask>(xianRenPropCopy);
-                }
+        // Run selection combination.
+        Timer timer;
+#if USE_BRANCH_AND_BOUND_FOR_XIANREN_SELECTION
+        const auto topGearBuffsTable =
+            GetTopGearBuffsTable<kXianRenPropMask>(xianQiVec, maxEquiptNum);
 
-                // Apply all global buffs to final sum of each xianren prop
-                sumXianRenProp.ApplyBuff<kXianRenPropMask>(all_global_buffs);
+        const bool canPrune = isNotNegative;
 
-                // Select the best one
-                {
-                    auto sum = sumXianRenProp.li + sumXianRenProp.nian;
-                    if (sum > best_global_li_nian_sum_num)
-                    {
-                        bestComb                    = combIndexVec;
-                        best_xianren_prop_sum       = sumXianRenProp;
-                        best_global_li_nian_sum_num = sum;
+        // Cut the partial comb if even the top buffs of the remaining gears can not beat the best
+        // score, ties are kept since the earliest comb wins.
+        auto pruneFunc = [&](const XianRenGearBuffs& gearBuffs, std::size_t nextIndex,
+                             std::size_t numLeft, std::uint32_t) -> bool {
+            if (!canPrune)
+                return false;
 
-                        bestXianRenFinalPropVec = xianRenFinalPropStack;
-                    }
-                }
-            }
-            else
-            {
-                static_assert(false);
-            }
+            const auto& topGearBuffs = topGearBuffsTable[nextIndex][numLeft];
+
+            XianRenGearBuffs optimisticBuffs = gearBuffs;
+            optimisticBuffs.individual.IncreaseBy<kXianRenPropMask>(topGearBuffs.individual);
+            if constexpr (kUseGlobalBuffs)
+                optimisticBuffs.global.IncreaseBy<kXianRenPropMask>(topGearBuffs.global);
+
+            return getScore(getXianRenPropSum(optimisticBuffs, nullptr)) <
+                topCombsThreshold.load(std::memory_order_relaxed);
         };
 
-        // Run selection combination.
-        Timer timer;
-        auto numCombs =
-            SelectCombination::RunSingleThread(xianQiVecSize, maxEquiptNum, combCallBack);
+        auto stats = SelectCombination::RunBranchAndBoundParallel(xianQiVecSize, maxEquiptNum,
+            XianRenGearBuffs(), increaseGearBuffs, pruneFunc, evaluateComb);
+        auto numCombs = stats.numLeaves + stats.numPrunedCombs;
+#else
+        auto numCombs = RunGearCombs(xianQiVecSize, maxEquiptNum, buffArithmetic,
+            [&](std::uint64_t combMask, std::uint32_t removedIndex, std::uint32_t addedIndex,
+                std::uint32_t workerIndex) -> void {
+                XianRenGearBuffs& gearBuffs = workerStateVec[workerIndex].gearBuffs;
+
+                // Accomulate buffs of each Xian Qi, or only update the changed ones.
+                if (removedIndex == SelectCombination::k_revolvingDoorNoChange)
+                {
+                    gearBuffs = getGearBuffs(combMask);
+                }
+                else
+                {
+                    decreaseGearBuffs(gearBuffs, removedIndex);
+                    increaseGearBuffs(gearBuffs, addedIndex);
+                }
+
+                evaluateComb(gearBuffs, combMask, workerIndex);
+            });
+#endif
 
         std::cout << u8"仙器挑选耗时: " << timer.DurationInSec() << u8"秒" << std::endl;
         std::cout << u8"共计算组合数: " << numCombs << std::endl;
+#if USE_BRANCH_AND_BOUND_FOR_XIANREN_SELECTION
+        std::cout << u8"剪枝节点数: " << stats.numPrunedNodes
+                  << u8", 剪枝跳过组合数: " << stats.numPrunedCombs << std::endl;
+#endif
         PrintLargeSpace();
 
         if (numCombs != expectedCombSize)
@@ -354,6 +843,21 @@ public:
             return false;
         }
 
+        // Merge the top combs of all workers.
+        const auto sortedTopCombs = MergeWorkerTopCombs(workerStateVec).GetSortedCombs();
+        if (sortedTopCombs.empty())
+        {
+            errorStr += u8"未能找到任何有效的仙器组合!\n";
+            assert(false);
+            return false;
+        }
+
+        // Compute the details of the best one.
+        const auto bestCombMask = sortedTopCombs.front().combMask;
+        std::vector<XianRenProp> bestXianRenFinalPropVec(xianRenVecSize);
+        const auto best_xianren_prop_sum =
+            getXianRenPropSum(getGearBuffs(bestCombMask), bestXianRenFinalPropVec.data());
+
         for (int i = 0; i < xianRenVecSize; ++i)
         {
             if (i != 0)
@@ -366,10 +870,9 @@ public:
 
         std::vector<const GearData*> selectedGears;
         selectedGears.reserve(maxEquiptNum);
-        for (auto& combIndex : bestComb)
-        {
+        BitHelper::ForEachSetBit(bestCombMask, [&](std::uint32_t combIndex) {
             selectedGears.emplace_back(xianQiVec[combIndex]);
-        }
+        });
         std::cout << u8"挑选仙器: " << std::endl;
         PrintSmallSpace();
         XianRenPropBuff xianQi_individual_buff_sum;
@@ -409,6 +912,26 @@ public:
 
         PrintLargeSpace();
 
+        // Other top combs
+        if (sortedTopCombs.size() > 1)
+        {
+            std::cout << u8"其他候选仙器组合, 按评分由高到低排列:" << std::endl;
+            for (std::size_t rank = 1; rank < sortedTopCombs.size(); ++rank)
+            {
+                const auto combMask = sortedTopCombs[rank].combMask;
+
+                PrintSmallSpace();
+                std::cout << u8"第" << rank + 1 << u8"名, 挑选仙器: " << std::endl;
+                BitHelper::ForEachSetBit(combMask, [&](std::uint32_t combIndex) {
+                    std::cout << xianQiVec[combIndex]->name << std::endl;
+                });
+                std::cout << u8"仙人属性总和:" << std::endl
+                          << getXianRenPropSum(getGearBuffs(combMask), nullptr).ToString()
+                          << std::endl;
+            }
+            PrintLargeSpace();
+        }
+
         return true;
     }
 };
@@ -418,8 +941,9 @@ template <Calculator::Solution SolutionType,
         SolutionType == Calculator::Solution::BestChanNeng>>
 struct ChanYeSelector : public SolutionSelectorBase
 {
-    ChanYeSelector(const XianJieFileData& xianJieFileData, const XianQiFileData& xianQiFileData) :
-        SolutionSelectorBase(xianJieFileData, xianQiFileData)
+    ChanYeSelector(const XianJieFileData& xianJieFileData, const XianQiFileData& xianQiFileData,
+        const CalcTables& calcTables) :
+        SolutionSelectorBase(xianJieFileData, xianQiFileData, calcTables)
     {
     }
 
@@ -449,10 +973,47 @@ struct ChanYeSelector : public SolutionSelectorBase
         const auto& xianRenVec    = m_xianJieFileData.GetCalcXianRenDataVec();
         const auto xianRenVecSize = xianRenVec.size();
 
-        // XianQi related refs and consts.
-        const auto& xianQiVec    = m_xianQiFileData.GetCalcGearsVec();
-        const auto xianQiVecSize = xianQiVec.size();
-        const auto maxEquiptNum  = m_xianQiFileData.GetMaxNumEquip();
+        // Init chan ye self buff vec
+        const std::vector<ChanyePropBuff> chanyeFieldStaticBuffVec =
+            GameAlgorithms::GetChanyeStaicBuffVec<kChanyeCat>(m_xianJieFileData, chanyeVec);
+
+        // Xian ren static buff vec
+        const auto& xianRenStaticBuffVec = m_calcTables.xianRenStaticBuffs;
+
+        // More buffs never lower the output as long as all props, buffs and weights are not
+        // negative.
+        bool isNotNegative = true;
+        for (std::size_t i = 0; i < chanyeVecSize; ++i)
+        {
+            const auto& chanyeData = chanyeVec[i];
+            isNotNegative          = isNotNegative && IsNotNegative(chanyeFieldStaticBuffVec[i]) &&
+                chanyeData.li_weight >= 0.0 && chanyeData.nian_weight >= 0.0 &&
+                chanyeData.fu_weight >= 0.0;
+        }
+        for (std::size_t i = 0; i < xianRenVecSize; ++i)
+        {
+            isNotNegative = isNotNegative && IsNotNegative(xianRenVec[i]->baseProp) &&
+                IsNotNegative(xianRenStaticBuffVec[i]);
+        }
+        for (const auto* pXianQi : m_calcTables.gearTables.gears)
+        {
+            isNotNegative = isNotNegative && IsNotNegative(pXianQi->individualBuff) &&
+                IsNotNegative(pXianQi->chanyeBuff);
+        }
+
+        // XianQi related refs and consts, dominated gears can be dropped only when a single best
+        // comb is wanted.
+        const auto gearTables = SelectGears(isNotNegative &&
+                m_xianQiFileData.GetNumOutputCombs() == 1,
+            [](const GearTables& tables, std::uint32_t a, std::uint32_t b) -> bool {
+                return IsNotLess<kXianRenPropMask>(
+                           tables.individualBuffs[a], tables.individualBuffs[b]) &&
+                    IsNotLess<kChanyePropMask>(tables.chanyeBuffs[a], tables.chanyeBuffs[b]);
+            });
+        const auto& xianQiVec     = gearTables.gears;
+        const auto xianQiVecSize  = xianQiVec.size();
+        const auto maxEquiptNum   = m_xianQiFileData.GetMaxNumEquip();
+        const auto buffArithmetic = m_xianQiFileData.GetBuffArithmetic();
 
         const auto expectedCombSize =
             SelectCombination::GetNumOfSelectionComb(xianQiVecSize, maxEquiptNum);
@@ -462,10 +1023,21 @@ struct ChanYeSelector : public SolutionSelectorBase
             assert(false);
             return false;
         }
+        if (xianQiVecSize > PickIndex::k_maxInputSize)
+        {
+            errorStr += FormatString(u8"参与计算的仙器数不能超过", PickIndex::k_maxInputSize,
+                u8"个, 当前为: ", xianQiVecSize, "\n");
+            assert(false);
+            return false;
+        }
 
         std::cout << u8"需计算仙人数: " << xianRenVecSize << std::endl;
         std::cout << u8"需计算仙器数: " << xianQiVecSize << std::endl;
         std::cout << u8"可装备个数: " << maxEquiptNum << std::endl;
+        if (m_xianQiFileData.GetNumOutputCombs() > 1)
+            std::cout << u8"输出组合个数: " << m_xianQiFileData.GetNumOutputCombs() << std::endl;
+        if (buffArithmetic == BuffArithmetic::FixedPoint)
+            std::cout << u8"使用定点数计算" << std::endl;
         std::cout << u8"需计算: " << FormatNumber(expectedCombSize) << u8" 种可能性" << std::endl;
         PrintLargeSpace();
 
@@ -475,15 +1047,6 @@ struct ChanYeSelector : public SolutionSelectorBase
             return false;
         }
 
-        // Init chan ye self buff vec
-        const std::vector<ChanyePropBuff> chanyeFieldStaticBuffVec =
-            GameAlgorithms::GetChanyeStaicBuffVec<kChanyeCat>(m_xianJieFileData, chanyeVec);
-
-        // Init xian ren static buff vec
-        const std::vector<XianRenPropBuff> xianRenStaticBuffVec =
-            GameAlgorithms::GetXianRenStaicBuffVec<kXianRenPropMask>(m_xianJieFileData, xianRenVec,
-                [](auto& element) -> const XianRenData& { return *element; });
-
         // Select Xian Ren for each Chanye field
         struct SelectedChanyeXianRen
         {
@@ -526,15 +1089,14 @@ struct ChanYeSelector : public SolutionSelectorBase
 
                 for (std::uint32_t xianRenIndex = 0; xianRenIndex < xianRenVecSize; ++xianRenIndex)
                 {
-                    const auto* pXianRen = xianRenVec[xianRenIndex];
-
                     // Calculate xianren prop without gears
-                    auto xianRenPropCopy = pXianRen->baseProp;
-                    xianRenPropCopy.ApplyBuff<kXianRenPropMask>(xianRenStaticBuffVec[xianRenIndex]);
+                    auto xianRenPropCopy = m_calcTables.xianRenBaseProps[xianRenIndex];
+                    xianRenPropCopy.ApplyBuff<kXianRenPropMask>(
+                        xianRenStaticBuffVec[xianRenIndex], buffArithmetic);
 
                     // Calculate chanye output without gears
-                    GameAlgorithms::GetChanyeProp(
-                        xianRenPropCopy, chanyeData, chanyeStaticBuff, chanyePropStack);
+                    GameAlgorithms::GetChanyeProp(xianRenPropCopy, chanyeData, chanyeStaticBuff,
+                        buffArithmetic, chanyePropStack);
 
                     allChanyeWeightVec.emplace_back(
                         xianRenIndex, chanyeIndex, chanyePropStack.output);
@@ -601,6 +1163,8 @@ struct ChanYeSelector : public SolutionSelectorBase
         ChanyePropType bestChanyeProp;
         std::vector<XianRenProp> bestXianRenFinalPropVec;
         std::vector<ChanyePropType> bestChanyeFinalOutputVec;
+        // Comb mask and chanye prop sum of other top combs
+        std::vector<std::pair<std::uint64_t, ChanyePropType>> otherTopCombs;
         {
 
             if (selectedXianRenVec.empty())
@@ -610,29 +1174,52 @@ struct ChanYeSelector : public SolutionSelectorBase
                 return false;
             }
 
-            // Best ones
-            using CombVecType = std::vector<std::size_t>;
-            CombVecType bestComb;
-            std::vector<XianRenProp> xianRenFinalPropStack(xianRenVecSize);
-            std::vector<ChanyePropType> chanyeFinalOutputStack(chanyeVecSize);
-            auto combCallBack = [&](const CombVecType& combIndexVec,
-                                    std::size_t indexOfComb) -> void {
-                // Accomulate all individual buff and all chanye buff of each Xian Qi
-                // xianjie buffs + xianQi buffs
-                XianRenPropBuff xianQi_individual_buffs;
-                ChanyePropBuff xianQi_chanye_buff;
-                for (auto& combIndex : combIndexVec)
+            // Init structure of arrays of selected xian ren, along with the range of the xian ren
+            // of each chanye in it.
+            struct ChanyeXianRenRange
+            {
+                std::uint32_t chanyeIndex;
+                std::size_t beginIndex;
+                std::size_t endIndex;
+            };
+            std::vector<ChanyeXianRenRange> chanyeXianRenRangeVec;
+            XianRenPropKernel selectedXianRenPropKernel;
+            {
+                std::vector<XianRenProp> selectedBasePropVec(selectedXianRenSize);
+                std::vector<XianRenPropBuff> selectedStaticBuffVec(selectedXianRenSize);
+                for (std::size_t i = 0; i < selectedXianRenSize; ++i)
                 {
-                    const auto& xianQi = xianQiVec[combIndex];
-
-                    xianQi_individual_buffs.IncreaseBy<kXianRenPropMask>(xianQi->individualBuff);
-                    xianQi_chanye_buff.IncreaseBy<kChanyePropMask>(xianQi->chanyeBuff);
+                    const auto& selectedXianRen = selectedXianRenVec[i];
+                    const auto xianRenIndex     = selectedXianRen.xianRenIndexInXianRenVec;
+                    selectedBasePropVec[i]      = m_calcTables.xianRenBaseProps[xianRenIndex];
+                    selectedStaticBuffVec[i]    = xianRenStaticBuffVec[xianRenIndex];
+
+                    if (chanyeXianRenRangeVec.empty() ||
+                        chanyeXianRenRangeVec.back().chanyeIndex !=
+                            selectedXianRen.chanyeIndexInChanyeVec)
+                    {
+                        chanyeXianRenRangeVec.push_back(
+                            {selectedXianRen.chanyeIndexInChanyeVec, i, i});
+                    }
+                    ++chanyeXianRenRangeVec.back().endIndex;
                 }
+                selectedXianRenPropKernel.Init(selectedBasePropVec, selectedStaticBuffVec,
+                    buffArithmetic, USE_SIMD_FOR_XIANREN_PROP_KERNEL);
+            }
 
+            // Sum of chanye props with given gear buffs, the final prop of each xian ren and the
+            // final output of each chanye are written to pXianRenFinalProps and
+            // pChanyeFinalOutputs if they are not null.
+            auto getChanyePropSum = [&](const XianRenPropBuff& xianQi_individual_buffs,
+                                        const ChanyePropBuff& xianQi_chanye_buff,
+                                        XianRenProp* pXianRenFinalProps,
+                                        ChanyePropType* pChanyeFinalOutputs) -> ChanyePropType {
                 // Apply all individual buffs to each Xian Ren
                 XianRenProp sumXianRenProp;
                 std::uint32_t currentChanyeIndex = selectedXianRenVec[0].chanyeIndexInChanyeVec;
                 ChanyePropType sumChanyeProp;
+                XianRenProp xianRenProp;
+                ChanyePropType chanyeOutput;
 
                 // Helper function to output each chanye prop
                 auto outPutChanye = [&]() -> void {
@@ -640,14 +1227,28 @@ struct ChanYeSelector : public SolutionSelectorBase
                         chanyeFieldStaticBuffVec[currentChanyeIndex].Add<kChanyePropMask>(
                             xianQi_chanye_buff);
 
-                    auto& chanyeProp = chanyeFinalOutputStack[currentChanyeIndex];
-                    GameAlgorithms::GetChanyeProp(
-                        sumXianRenProp, chanyeVec[currentChanyeIndex], allChanyeBuffs, chanyeProp);
+                    auto& chanyeProp =
+                        pChanyeFinalOutputs ? pChanyeFinalOutputs[currentChanyeIndex] : chanyeOutput;
+                    GameAlgorithms::GetChanyeProp(sumXianRenProp, chanyeVec[currentChanyeIndex],
+                        allChanyeBuffs, buffArithmetic, chanyeProp);
 
                     // Accomulate the chanye prop
                     sumChanyeProp += chanyeProp;
                 };
 
+                if (pXianRenFinalProps == nullptr)
+                {
+                    for (const auto& range : chanyeXianRenRangeVec)
+                    {
+                        currentChanyeIndex = range.chanyeIndex;
+                        sumXianRenProp =
+                            selectedXianRenPropKernel.ApplyBuffAndSum<kXianRenPropMask>(
+                                xianQi_individual_buffs, range.beginIndex, range.endIndex);
+                        outPutChanye();
+                    }
+                    return sumChanyeProp;
+                }
+
                 for (const SelectedChanyeXianRen& selectedXianRen : selectedXianRenVec)
                 {
                     // End of one of chanyeField accomulating
@@ -669,12 +1270,13 @@ struct ChanYeSelector : public SolutionSelectorBase
                         xianRenStaticBuffVec[selectedXianRen.xianRenIndexInXianRenVec]);
 
                     // Apply all buffs to xian ren.
-                    auto& xianRenPropCopy =
-                        xianRenFinalPropStack[selectedXianRen.xianRenIndexInXianRenVec];
+                    auto& xianRenPropCopy = pXianRenFinalProps
+                        ? pXianRenFinalProps[selectedXianRen.xianRenIndexInXianRenVec]
+                        : xianRenProp;
 
                     xianRenPropCopy =
-                        xianRenVec[selectedXianRen.xianRenIndexInXianRenVec]->baseProp;
-                    xianRenPropCopy.ApplyBuff<kXianRenPropMask>(allXianRenBuffs);
+                        m_calcTables.xianRenBaseProps[selectedXianRen.xianRenIndexInXianRenVec];
+                    xianRenPropCopy.ApplyBuff<kXianRenPropMask>(allXianRenBuffs, buffArithmetic);
 
                     // Accomulate the sum of each Xian Prop of current chanye field.
                     sumXianRenProp.IncreaseBy<kXianRenPropMask>(xianRenPropCopy);
@@ -683,23 +1285,71 @@ struct ChanYeSelector : public SolutionSelectorBase
                 // Ouput the tailing chanye
                 outPutChanye();
 
-                // Select the best one
-                {
-                    if (sumChanyeProp.output > bestChanyeProp.output)
-                    {
-                        bestComb       = combIndexVec;
-                        bestChanyeProp = sumChanyeProp;
+                return sumChanyeProp;
+            };
 
-                        bestXianRenFinalPropVec  = xianRenFinalPropStack;
-                        bestChanyeFinalOutputVec = chanyeFinalOutputStack;
-                    }
+            // Accomulate all individual buff and all chanye buff of each Xian Qi in ascending
+            // order of gears.
+            const auto& gearIndividualBuffs = gearTables.individualBuffs;
+            const auto& gearChanyeBuffs     = gearTables.chanyeBuffs;
+            auto getGearBuffs = [&](std::uint64_t combMask, XianRenPropBuff& xianQi_individual_buffs,
+                                    ChanyePropBuff& xianQi_chanye_buff) -> void {
+                xianQi_individual_buffs.Reset();
+                xianQi_chanye_buff.Reset();
+                BitHelper::ForEachSetBit(combMask, [&](std::uint32_t combIndex) {
+                    xianQi_individual_buffs.IncreaseBy<kXianRenPropMask>(
+                        gearIndividualBuffs[combIndex]);
+                    xianQi_chanye_buff.IncreaseBy<kChanyePropMask>(gearChanyeBuffs[combIndex]);
+                });
+            };
+
+            // States of each worker, every worker owns its states to avoid any data race.
+            struct WorkerState
+            {
+                explicit WorkerState(std::size_t maxNumCombs) : topCombs(maxNumCombs) {}
+
+                TopCombs<double> topCombs;
+
+                // Gear buffs of current comb
+                XianRenPropBuff xianQi_individual_buffs;
+                ChanyePropBuff xianQi_chanye_buff;
+            };
+            const std::size_t numOutputCombs = m_xianQiFileData.GetNumOutputCombs();
+            std::vector<WorkerState> workerStateVec(
+                SelectCombination::GetNumParallelWorkers(), WorkerState(numOutputCombs));
+
+            auto combCallBack = [&](std::uint64_t combMask, std::uint32_t removedIndex,
+                                    std::uint32_t addedIndex, std::uint32_t workerIndex) -> void {
+                auto& workerState                        = workerStateVec[workerIndex];
+                XianRenPropBuff& xianQi_individual_buffs = workerState.xianQi_individual_buffs;
+                ChanyePropBuff& xianQi_chanye_buff       = workerState.xianQi_chanye_buff;
+
+                // Accomulate all individual buff and all chanye buff of each Xian Qi, or only
+                // update the changed ones.
+                if (removedIndex == SelectCombination::k_revolvingDoorNoChange)
+                {
+                    getGearBuffs(combMask, xianQi_individual_buffs, xianQi_chanye_buff);
+                }
+                else
+                {
+                    xianQi_individual_buffs.DecreaseBy<kXianRenPropMask>(
+                        gearIndividualBuffs[removedIndex]);
+                    xianQi_individual_buffs.IncreaseBy<kXianRenPropMask>(
+                        gearIndividualBuffs[addedIndex]);
+                    xianQi_chanye_buff.DecreaseBy<kChanyePropMask>(gearChanyeBuffs[removedIndex]);
+                    xianQi_chanye_buff.IncreaseBy<kChanyePropMask>(gearChanyeBuffs[addedIndex]);
                 }
+
+                // Keep it if it is one of the top combs
+                auto sumChanyeProp = getChanyePropSum(
+                    xianQi_individual_buffs, xianQi_chanye_buff, nullptr, nullptr);
+                workerState.topCombs.Insert(sumChanyeProp.output, combMask);
             };
 
             // Run selection combination.
             Timer timer;
             auto numCombs =
-                SelectCombination::RunSingleThread(xianQiVecSize, maxEquiptNum, combCallBack);
+                RunGearCombs(xianQiVecSize, maxEquiptNum, buffArithmetic, combCallBack);
 
             if (numCombs != expectedCombSize)
             {
@@ -713,10 +1363,41 @@ struct ChanYeSelector : public SolutionSelectorBase
             std::cout << u8"共计算组合数: " << numCombs << std::endl;
             PrintSmallSpace();
 
-            selectedGears.reserve(maxEquiptNum);
-            for (auto& combIndex : bestComb)
+            // Merge the top combs of all workers.
+            const auto sortedTopCombs = MergeWorkerTopCombs(workerStateVec).GetSortedCombs();
+            if (sortedTopCombs.empty())
+            {
+                errorStr += u8"未能找到任何有效的仙器组合!\n";
+                assert(false);
+                return false;
+            }
+
+            // Compute the details of the top combs.
+            XianRenPropBuff xianQi_individual_buffs;
+            ChanyePropBuff xianQi_chanye_buff;
+            for (std::size_t rank = 0; rank < sortedTopCombs.size(); ++rank)
             {
-                selectedGears.emplace_back(xianQiVec[combIndex]);
+                const auto combMask = sortedTopCombs[rank].combMask;
+                getGearBuffs(combMask, xianQi_individual_buffs, xianQi_chanye_buff);
+
+                if (rank == 0)
+                {
+                    bestXianRenFinalPropVec.resize(xianRenVecSize);
+                    bestChanyeFinalOutputVec.resize(chanyeVecSize);
+                    bestChanyeProp = getChanyePropSum(xianQi_individual_buffs, xianQi_chanye_buff,
+                        bestXianRenFinalPropVec.data(), bestChanyeFinalOutputVec.data());
+
+                    selectedGears.reserve(maxEquiptNum);
+                    BitHelper::ForEachSetBit(combMask, [&](std::uint32_t combIndex) {
+                        selectedGears.emplace_back(xianQiVec[combIndex]);
+                    });
+                }
+                else
+                {
+                    otherTopCombs.emplace_back(combMask,
+                        getChanyePropSum(
+                            xianQi_individual_buffs, xianQi_chanye_buff, nullptr, nullptr));
+                }
             }
         }
 
@@ -795,6 +1476,22 @@ struct ChanYeSelector : public SolutionSelectorBase
         std::cout << u8"每轮总收益:" << std::endl << bestChanyeProp.ToString();
         PrintLargeSpace();
 
+        // Other top combs
+        if (!otherTopCombs.empty())
+        {
+            std::cout << u8"其他候选仙器组合, 按评分由高到低排列:" << std::endl;
+            for (std::size_t i = 0; i < otherTopCombs.size(); ++i)
+            {
+                PrintSmallSpace();
+                std::cout << u8"第" << i + 2 << u8"名, 挑选仙器: " << std::endl;
+                BitHelper::ForEachSetBit(otherTopCombs[i].first, [&](std::uint32_t combIndex) {
+                    std::cout << xianQiVec[combIndex]->name << std::endl;
+                });
+                std::cout << u8"每轮总收益:" << std::endl << otherTopCombs[i].second.ToString();
+            }
+            PrintLargeSpace();
+        }
+
         return true;
     }
 };
@@ -815,14 +1512,18 @@ void TestSelectComb()
     // Get the results using single thread.
     Timer timer;
     std::unordered_set<std::size_t, Hasher> uniqueCombs;
+    std::unordered_set<std::uint64_t> uniqueCombMasks;
     {
         auto numCombs = SelectCombination::RunSingleThread(kNumElement, kNumSelect,
             [&](const std::vector<std::size_t>& combIndexVec, std::size_t indexOfComb) -> void {
                 std::size_t hash = ComputeHash(indexOfComb);
+                std::uint64_t combMask = 0;
                 for (auto index : combIndexVec)
                 {
                     HashCombine(hash, index);
+                    combMask |= PickIndex::k_inputIndexBitMask[index];
                 }
+                uniqueCombMasks.emplace(combMask);
 
                 auto insertedPair = uniqueCombs.emplace(hash);
                 if (!insertedPair.second)
@@ -872,6 +1573,159 @@ void TestSelectComb()
         }
     }
     std::cout << "Multi thread cost: " << timer.DurationInSec() << std::endl;
+
+    timer.Reset();
+    // Compare the results using parallel workers.
+    {
+        std::atomic<std::size_t> numCompared = 0;
+        auto numCombs = SelectCombination::RunParallel(kNumElement, kNumSelect,
+            [&](const std::vector<std::size_t>& combIndexVec, std::size_t indexOfComb,
+                std::uint32_t workerIndex) -> void {
+                std::size_t hash = ComputeHash(indexOfComb);
+                for (auto index : combIndexVec)
+                {
+                    HashCombine(hash, index);
+                }
+
+                auto it = uniqueCombs.find(hash);
+                if (it == uniqueCombs.end())
+                {
+                    assert(false);
+                    throw std::runtime_error("Unexpected comb found using parallel workers!\n");
+                }
+                ++numCompared;
+            });
+        if (numCombs != uniqueCombs.size() || numCompared != uniqueCombs.size())
+        {
+            assert(false);
+            throw std::runtime_error("Parallel solution has different results!\n");
+        }
+    }
+    std::cout << "Parallel cost: " << timer.DurationInSec() << std::endl;
+
+    timer.Reset();
+    // Compare the results using bit mask solution, masks are in increasing order.
+    {
+        std::uint64_t prevMask = 0;
+        auto numCombs          = SelectCombination::RunBitMask(kNumElement, kNumSelect,
+            [&](std::uint64_t combMask, std::size_t indexOfComb) -> void {
+                if (combMask <= prevMask || uniqueCombMasks.find(combMask) == uniqueCombMasks.end())
+                {
+                    assert(false);
+                    throw std::runtime_error("Unexpected comb found using bit mask!\n");
+                }
+                if (SelectCombination::UnrankBitMaskComb(kNumElement, kNumSelect, indexOfComb) !=
+                    combMask)
+                {
+                    assert(false);
+                    throw std::runtime_error("Unexpected bit mask comb of index!\n");
+                }
+                prevMask = combMask;
+            });
+        if (numCombs != uniqueCombMasks.size())
+        {
+            assert(false);
+            throw std::runtime_error("Bit mask solution has different results!\n");
+        }
+    }
+    std::cout << "Bit mask cost: " << timer.DurationInSec() << std::endl;
+
+    timer.Reset();
+    // Compare the results using bit mask parallel workers.
+    {
+        std::atomic<std::size_t> numCompared = 0;
+        auto numCombs = SelectCombination::RunBitMaskParallel(kNumElement, kNumSelect,
+            [&](std::uint64_t combMask, std::size_t indexOfComb, std::uint32_t workerIndex) -> void {
+                if (uniqueCombMasks.find(combMask) == uniqueCombMasks.end())
+                {
+                    assert(false);
+                    throw std::runtime_error("Unexpected comb found using bit mask workers!\n");
+                }
+                ++numCompared;
+            });
+        if (numCombs != uniqueCombMasks.size() || numCompared != uniqueCombMasks.size())
+        {
+            assert(false);
+            throw std::runtime_error("Bit mask parallel solution has different results!\n");
+        }
+    }
+    std::cout << "Bit mask parallel cost: " << timer.DurationInSec() << std::endl;
+
+    timer.Reset();
+    // Compare the results using revolving door order, each comb removes one element of the previous
+    // comb and adds one which is not in it. Combs of all workers are collected to check that none
+    // of them is run twice.
+    {
+        struct WorkerState
+        {
+            std::uint64_t prevMask = 0;
+            std::vector<std::uint64_t> combMasks;
+        };
+        std::vector<WorkerState> workerStateVec(SelectCombination::GetNumParallelWorkers());
+        auto numCombs = SelectCombination::RunRevolvingDoorParallel(kNumElement, kNumSelect,
+            [&](std::uint64_t combMask, std::uint32_t removedIndex, std::uint32_t addedIndex,
+                std::size_t indexOfComb, std::uint32_t workerIndex) -> void {
+                auto& workerState = workerStateVec[workerIndex];
+                if (uniqueCombMasks.find(combMask) == uniqueCombMasks.end())
+                {
+                    assert(false);
+                    throw std::runtime_error("Unexpected comb found using revolving door!\n");
+                }
+                if ((removedIndex == SelectCombination::k_revolvingDoorNoChange) !=
+                    (addedIndex == SelectCombination::k_revolvingDoorNoChange))
+                {
+                    assert(false);
+                    throw std::runtime_error("Revolving door comb changes only one side!\n");
+                }
+                if (removedIndex != SelectCombination::k_revolvingDoorNoChange)
+                {
+                    const auto removedBit = PickIndex::k_inputIndexBitMask[removedIndex];
+                    const auto addedBit   = PickIndex::k_inputIndexBitMask[addedIndex];
+                    if ((workerState.prevMask & removedBit) == 0 || (combMask & removedBit) != 0 ||
+                        (workerState.prevMask & addedBit) != 0 || (combMask & addedBit) == 0 ||
+                        (workerState.prevMask ^ combMask) != (removedBit | addedBit))
+                    {
+                        assert(false);
+                        throw std::runtime_error(
+                            "Revolving door comb does not swap exactly one element!\n");
+                    }
+                }
+                workerState.prevMask = combMask;
+                workerState.combMasks.push_back(combMask);
+            });
+
+        std::vector<std::uint64_t> allCombMasks;
+        allCombMasks.reserve(uniqueCombMasks.size());
+        for (const auto& workerState : workerStateVec)
+        {
+            allCombMasks.insert(
+                allCombMasks.end(), workerState.combMasks.begin(), workerState.combMasks.end());
+        }
+        std::sort(allCombMasks.begin(), allCombMasks.end());
+        if (std::adjacent_find(allCombMasks.begin(), allCombMasks.end()) != allCombMasks.end())
+        {
+            assert(false);
+            throw std::runtime_error("Revolving door comb is run more than once!\n");
+        }
+        if (numCombs != uniqueCombMasks.size() || allCombMasks.size() != uniqueCombMasks.size())
+        {
+            assert(false);
+            throw std::runtime_error("Revolving door solution has different results!\n");
+        }
+    }
+    std::cout << "Revolving door cost: " << timer.DurationInSec() << std::endl;
+
+    // Full 64 bits mask must not overflow.
+    {
+        std::uint64_t lastMask = 0;
+        auto numCombs          = SelectCombination::RunBitMask(64, 63,
+            [&](std::uint64_t combMask, std::size_t indexOfComb) -> void { lastMask = combMask; });
+        if (numCombs != 64 || lastMask != ~PickIndex::k_inputIndexBitMask[0])
+        {
+            assert(false);
+            throw std::runtime_error("Unexpected bit mask comb of 64 elements!\n");
+        }
+    }
 }
 
 void TestSelectionComb()
@@ -948,6 +1802,277 @@ void TestSelectionComb()
         throw std::runtime_error("sizeOfReults should equal to exptectedResultSize\n");
     }
 }
+
+void TestXianRenPropKernel()
+{
+    constexpr std::size_t kNumXianRen = 23;
+    constexpr int kNumRounds          = 2000;
+
+    std::mt19937 randomEngine(1988);
+    auto randomPercent = [&]() {
+        // Percents are given with at most 2 decimals.
+        return std::uniform_int_distribution<int>(-5000, 50000)(randomEngine) * 0.01;
+    };
+    auto randomAdd = [&]() {
+        return std::uniform_int_distribution<std::uint32_t>(0, 1000000)(randomEngine);
+    };
+    auto randomBuff = [&]() {
+        XianRenPropBuff buff;
+        buff.li_add       = randomAdd();
+        buff.nian_add     = randomAdd();
+        buff.fu_add       = randomAdd();
+        buff.li_percent   = randomPercent();
+        buff.nian_percent = randomPercent();
+        buff.fu_percent   = randomPercent();
+        return buff;
+    };
+
+    // Integral base props and fractional ones, which are summed in different ways.
+    for (auto [isIntegral, arithmetic] : {std::make_pair(true, BuffArithmetic::Floating),
+             std::make_pair(false, BuffArithmetic::Floating),
+             std::make_pair(false, BuffArithmetic::FixedPoint)})
+    {
+        std::vector<XianRenProp> basePropVec(kNumXianRen);
+        std::vector<XianRenPropBuff> staticBuffVec(kNumXianRen);
+        for (std::size_t i = 0; i < kNumXianRen; ++i)
+        {
+            auto& baseProp = basePropVec[i];
+            for (double* pValue : {&baseProp.li, &baseProp.nian, &baseProp.fu})
+            {
+                const double value = std::uniform_real_distribution<double>(1.0, 1e4)(randomEngine);
+                *pValue = isIntegral ? std::trunc(value) * UnitScale::k_10K : value;
+            }
+            staticBuffVec[i] = randomBuff();
+        }
+
+        XianRenPropKernel simdKernel;
+        XianRenPropKernel scalarKernel;
+        simdKernel.Init(basePropVec, staticBuffVec, arithmetic, true);
+        scalarKernel.Init(basePropVec, staticBuffVec, arithmetic, false);
+        std::cout << "XianRenPropKernel AVX2: " << simdKernel.IsUsingAvx2() << std::endl;
+
+        for (int round = 0; round < kNumRounds; ++round)
+        {
+            const auto gearBuff   = randomBuff();
+            const auto beginIndex = std::uniform_int_distribution<std::size_t>(
+                0, kNumXianRen)(randomEngine);
+            const auto endIndex = std::uniform_int_distribution<std::size_t>(
+                beginIndex, kNumXianRen)(randomEngine);
+
+            XianRenProp expected;
+            for (std::size_t i = beginIndex; i < endIndex; ++i)
+            {
+                auto xianRenProp = basePropVec[i];
+                xianRenProp.ApplyBuff(gearBuff.Add(staticBuffVec[i]), arithmetic);
+                expected.IncreaseBy(xianRenProp);
+            }
+
+            for (const auto* pKernel : {&simdKernel, &scalarKernel})
+            {
+                const auto sum = pKernel->ApplyBuffAndSum(gearBuff, beginIndex, endIndex);
+                if (std::memcmp(&sum, &expected, sizeof(XianRenProp)) != 0)
+                {
+                    assert(false);
+                    throw std::runtime_error(
+                        "XianRenPropKernel should be bit exact to ApplyBuff\n");
+                }
+            }
+        }
+    }
+}
+
+void TestFixedPointMath()
+{
+    std::mt19937 randomEngine(1988);
+    for (int round = 0; round < 100000; ++round)
+    {
+        // Small enough to compute value * basisPoints directly, but large basis points are still
+        // split by MultiplyTrunc.
+        const std::int64_t value =
+            std::uniform_int_distribution<std::int64_t>(-(1ll << 40), 1ll << 40)(randomEngine);
+        const std::int64_t basisPoints =
+            std::uniform_int_distribution<std::int64_t>(-(1ll << 21), 1ll << 21)(randomEngine);
+
+        const auto expected = value * basisPoints / FixedPointMath::k_basisPointsPerOne;
+        if (FixedPointMath::MultiplyTrunc(value, basisPoints) != expected)
+        {
+            assert(false);
+            throw std::runtime_error("FixedPointMath::MultiplyTrunc is not exact\n");
+        }
+    }
+
+    // 0.57% is not exact in double, trunc(10000 * 0.57 * 0.01) is 56 instead of 57.
+    if (FixedPointMath::MultiplyBuff(10000.0, 0.57) != 10057.0)
+    {
+        assert(false);
+        throw std::runtime_error("FixedPointMath::MultiplyBuff should be exact\n");
+    }
+}
+
+void TestDominatedGears()
+{
+    // Gears of 2 fields, score of a comb grows with the sum of each field.
+    std::mt19937 randomEngine(1988);
+    for (int round = 0; round < 1000; ++round)
+    {
+        const std::size_t numGears =
+            std::uniform_int_distribution<std::size_t>(1, 10)(randomEngine);
+        const std::size_t numEquip =
+            std::uniform_int_distribution<std::size_t>(1, numGears)(randomEngine);
+        std::vector<std::pair<int, int>> gears(numGears);
+        for (auto& gear : gears)
+        {
+            gear.first  = std::uniform_int_distribution<int>(0, 4)(randomEngine);
+            gear.second = std::uniform_int_distribution<int>(0, 4)(randomEngine);
+        }
+
+        const auto droppedGears =
+            GetDominatedGears(numGears, numEquip, [&](std::uint32_t a, std::uint32_t b) {
+                return gears[a].first >= gears[b].first && gears[a].second >= gears[b].second;
+            });
+        std::uint64_t droppedMask = 0;
+        for (auto gearIndex : droppedGears)
+            droppedMask |= 1ull << gearIndex;
+
+        auto getBestScore = [&](std::uint64_t excludedMask) -> int {
+            int bestScore = -1;
+            for (std::uint64_t combMask = 0; combMask < (1ull << numGears); ++combMask)
+            {
+                if (BitHelper::PopCount(combMask) != numEquip || (combMask & excludedMask))
+                    continue;
+
+                int sumFirst  = 0;
+                int sumSecond = 0;
+                BitHelper::ForEachSetBit(combMask, [&](std::uint32_t gearIndex) {
+                    sumFirst += gears[gearIndex].first;
+                    sumSecond += gears[gearIndex].second;
+                });
+                bestScore = std::max(bestScore, std::min(sumFirst, sumSecond) * 100 + sumFirst);
+            }
+            return bestScore;
+        };
+
+        if (numGears - droppedGears.size() < numEquip ||
+            getBestScore(droppedMask) != getBestScore(0))
+        {
+            assert(false);
+            throw std::runtime_error("GetDominatedGears dropped the gear of the best comb\n");
+        }
+    }
+}
+
+void TestBranchAndBoundTopCombs()
+{
+    // Gears of 2 fields, score of a comb grows with the sum of each field. Small values make a lot
+    // of ties, which must be broken the same way as the exhaustive search.
+    std::mt19937 randomEngine(1989);
+    for (int round = 0; round < 300; ++round)
+    {
+        const std::size_t numGears =
+            std::uniform_int_distribution<std::size_t>(1, 16)(randomEngine);
+        const std::size_t numEquip =
+            std::uniform_int_distribution<std::size_t>(1, numGears)(randomEngine);
+        const std::size_t numOutputCombs =
+            std::uniform_int_distribution<std::size_t>(1, 20)(randomEngine);
+        std::vector<std::pair<int, int>> gears(numGears);
+        for (auto& gear : gears)
+        {
+            gear.first  = std::uniform_int_distribution<int>(0, 4)(randomEngine);
+            gear.second = std::uniform_int_distribution<int>(0, 4)(randomEngine);
+        }
+
+        auto getScore = [](const std::pair<int, int>& sums) -> double {
+            return std::min(sums.first, sums.second) * 100.0 + sums.first;
+        };
+        auto addGear = [&](std::pair<int, int>& sums, std::size_t gearIndex) -> void {
+            sums.first += gears[gearIndex].first;
+            sums.second += gears[gearIndex].second;
+        };
+
+        TopCombs<double> expected(numOutputCombs);
+        SelectCombination::RunBitMask(
+            numGears, numEquip, [&](std::uint64_t combMask, std::size_t) -> void {
+                std::pair<int, int> sums;
+                BitHelper::ForEachSetBit(
+                    combMask, [&](std::uint32_t gearIndex) { addGear(sums, gearIndex); });
+                expected.Insert(getScore(sums), combMask);
+            });
+
+        // Sums of the top fields of gears in [gearIndex, numGears), [gearIndex][numPicks].
+        std::vector<std::vector<std::pair<int, int>>> topSumsTable(
+            numGears + 1, std::vector<std::pair<int, int>>(numEquip + 1));
+        for (std::size_t gearIndex = 0; gearIndex < numGears; ++gearIndex)
+        {
+            std::vector<int> firsts;
+            std::vector<int> seconds;
+            for (auto i = gearIndex; i < numGears; ++i)
+            {
+                firsts.emplace_back(gears[i].first);
+                seconds.emplace_back(gears[i].second);
+            }
+            std::sort(firsts.begin(), firsts.end(), std::greater<int>());
+            std::sort(seconds.begin(), seconds.end(), std::greater<int>());
+
+            for (std::size_t numPicks = 1; numPicks <= numEquip && numPicks <= firsts.size();
+                 ++numPicks)
+            {
+                topSumsTable[gearIndex][numPicks].first =
+                    topSumsTable[gearIndex][numPicks - 1].first + firsts[numPicks - 1];
+                topSumsTable[gearIndex][numPicks].second =
+                    topSumsTable[gearIndex][numPicks - 1].second + seconds[numPicks - 1];
+            }
+        }
+
+        struct WorkerState
+        {
+            explicit WorkerState(std::size_t maxNumCombs) : topCombs(maxNumCombs) {}
+
+            TopCombs<double> topCombs;
+        };
+        std::vector<WorkerState> workerStateVec(
+            SelectCombination::GetNumParallelWorkers(), WorkerState(numOutputCombs));
+        std::atomic<double> topCombsThreshold = std::numeric_limits<double>::lowest();
+
+        auto pruneFunc = [&](const std::pair<int, int>& sums, std::size_t nextIndex,
+                             std::size_t numLeft, std::uint32_t) -> bool {
+            const auto& topSums = topSumsTable[nextIndex][numLeft];
+            return getScore({ sums.first + topSums.first, sums.second + topSums.second }) <
+                topCombsThreshold.load(std::memory_order_relaxed);
+        };
+        auto leafFunc = [&](const std::pair<int, int>& sums, std::uint64_t combMask,
+                            std::uint32_t workerIndex) -> void {
+            auto& topCombs = workerStateVec[workerIndex].topCombs;
+            if (topCombs.Insert(getScore(sums), combMask))
+                RaiseTopCombsThreshold(topCombsThreshold, topCombs);
+        };
+        auto stats = SelectCombination::RunBranchAndBoundParallel(
+            numGears, numEquip, std::pair<int, int>(), addGear, pruneFunc, leafFunc);
+
+        if (stats.numLeaves + stats.numPrunedCombs !=
+            SelectCombination::GetNumOfSelectionComb(numGears, numEquip))
+        {
+            assert(false);
+            throw std::runtime_error("Branch and bound missed some combs\n");
+        }
+
+        const auto expectedCombs = expected.GetSortedCombs();
+        const auto actualCombs   = MergeWorkerTopCombs(workerStateVec).GetSortedCombs();
+        if (actualCombs.size() != expectedCombs.size())
+        {
+            assert(false);
+            throw std::runtime_error("Branch and bound found wrong number of top combs\n");
+        }
+        for (std::size_t i = 0; i < actualCombs.size(); ++i)
+        {
+            if (actualCombs[i].score != expectedCombs[i].score ||
+                actualCombs[i].combMask != expectedCombs[i].combMask)
+            {
+                assert(false);
+                throw std::runtime_error("Branch and bound top combs differ from bit mask\n");
+            }
+        }
+    }
+}
 } // namespace UnitTest
 } // namespace
 
@@ -979,25 +2104,30 @@ bool Calculator::Run(std::string& errorStr, Solution solution)
 
     std::unique_ptr<SolutionSelectorBase> pSelector = nullptr;
 
+    // Shared by all solutions
+    CalcTables calcTables;
+    if (solution != Solution::Test)
+        calcTables.Init(m_xianJieFileData, m_xianQiFileData);
+
     switch (solution)
     {
     case Solution::BestXianRenSumProp:
         pSelector =
             SolutionSelectorBase::CreateInstance<XianRenGearSelector<Solution::BestXianRenSumProp>>(
-                m_xianJieFileData, m_xianQiFileData);
+                m_xianJieFileData, m_xianQiFileData, calcTables);
         break;
     case Solution::BestGlobalSumLiNian:
         pSelector = SolutionSelectorBase::CreateInstance<
             XianRenGearSelector<Solution::BestGlobalSumLiNian>>(
-            m_xianJieFileData, m_xianQiFileData);
+            m_xianJieFileData, m_xianQiFileData, calcTables);
         break;
     case Solution::BestChanJing:
         pSelector = SolutionSelectorBase::CreateInstance<ChanYeSelector<Solution::BestChanJing>>(
-            m_xianJieFileData, m_xianQiFileData);
+            m_xianJieFileData, m_xianQiFileData, calcTables);
         break;
     case Solution::BestChanNeng:
         pSelector = SolutionSelectorBase::CreateInstance<ChanYeSelector<Solution::BestChanNeng>>(
-            m_xianJieFileData, m_xianQiFileData);
+            m_xianJieFileData, m_xianQiFileData, calcTables);
         break;
     case Solution::Test:
     {
@@ -1007,6 +2137,10 @@ bool Calculator::Run(std::string& errorStr, Solution solution)
         {
             UnitTest::TestSelectionComb();
             UnitTest::TestSelectComb();
+            UnitTest::TestXianRenPropKernel();
+            UnitTest::TestFixedPointMath();
+            UnitTest::TestDominatedGears();
+            UnitTest::TestBranchAndBoundTopCombs();
         }
 #else
         errorStr += u8"测试模式仅供开发阶段使用\n";
@@ -807,6 +807,8 @@ struct XianqiProcessArrayDesc : public JsonUtils::JsonArrayDescBase
     }
 };
 constexpr auto k_gearKey_numEquip          = u8"仙器佩戴数量";
+constexpr auto k_gearKey_numOutputCombs    = u8"输出组合个数";
+constexpr auto k_gearKey_useFixedPoint     = u8"定点数计算";
 constexpr auto k_key_calculateXianQi_array = u8"参与运算仙器";
 } // namespace GearJson
 
@@ -1002,6 +1004,39 @@ bool XianQiFileData::ReadFromJsonFile(
         out.m_maxNumEquip = it->get<std::uint32_t>();
     }
 
+    // Parse num output combs, which is optional
+    {
+        auto it = jsonRoot.find(GearJson::k_gearKey_numOutputCombs);
+        if (it != jsonRoot.end())
+        {
+            if (!it->is_number_unsigned() || it->get<std::uint32_t>() < 1)
+            {
+                errorStr += FormatString(u8"文件: ", fileName, u8" 中的: ",
+                    GearJson::k_gearKey_numOutputCombs, u8" 必须为正整数\n");
+                return false;
+            }
+
+            out.m_numOutputCombs = it->get<std::uint32_t>();
+        }
+    }
+
+    // Parse buff arithmetic, which is optional
+    {
+        auto it = jsonRoot.find(GearJson::k_gearKey_useFixedPoint);
+        if (it != jsonRoot.end())
+        {
+            if (!it->is_boolean())
+            {
+                errorStr += FormatString(u8"文件: ", fileName, u8" 中的: ",
+                    GearJson::k_gearKey_useFixedPoint, u8" 必须为true或false\n");
+                return false;
+            }
+
+            out.m_buffArithmetic =
+                it->get<bool>() ? BuffArithmetic::FixedPoint : BuffArithmetic::Floating;
+        }
+    }
+
     // Parse each gear
     {
         auto succeed =
@@ -1026,7 +1061,9 @@ bool XianQiFileData::ReadFromJsonFile(
 void XianQiFileData::Reset()
 {
     m_calcGearsVec.clear();
-    m_maxNumEquip = 0;
+    m_maxNumEquip    = 0;
+    m_numOutputCombs = 1;
+    m_buffArithmetic = BuffArithmetic::Floating;
     m_loopUpGears.clear();
     m_gearsDataVec.clear();
 }
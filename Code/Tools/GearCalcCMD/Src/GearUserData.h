@@ -80,6 +80,67 @@ enum class XianRenPropertyMask : std::uint32_t
 };
 DEFINE_FLAG_ENUM_OPERATORS(XianRenPropertyMask);
 
+// How percent buffs are applied to props, it is selected by the calculator data.
+enum class BuffArithmetic : std::uint8_t
+{
+    // Props and percents in double, truncating the floating product.
+    Floating,
+
+    // Props in integers and percents in basis points (1/100 of a percent), so that the truncation
+    // is exact integer division and the same on all compilers. Percents of the game have at most 2
+    // decimals, so that they are exact in basis points.
+    FixedPoint
+};
+
+// Integer operations of BuffArithmetic::FixedPoint. Props are still stored in double to share the
+// structures with floating arithmetic, they are integers below 2^53 which are exact in double.
+struct FixedPointMath
+{
+    static constexpr std::int64_t k_basisPointsPerPercent = 100;
+    static constexpr std::int64_t k_basisPointsPerOne     = 10000;
+
+    // Round half away from zero as std::llround, but inlined since it is in the hot loop.
+    static std::int64_t ToInteger(double value)
+    {
+        const auto integer = static_cast<std::int64_t>(value);
+        // Exact for any double below 2^53
+        const double fraction = value - static_cast<double>(integer);
+        return integer + (fraction >= 0.5 ? 1 : 0) - (fraction <= -0.5 ? 1 : 0);
+    }
+    static std::int64_t ToBasisPoints(double percent)
+    {
+        return ToInteger(percent * k_basisPointsPerPercent);
+    }
+    static std::int64_t RatioToBasisPoints(double ratio)
+    {
+        return ToInteger(ratio * k_basisPointsPerOne);
+    }
+
+    // trunc(value * basisPoints / 10000). Large values are split by 10000 first so that the
+    // product does not overflow.
+    static constexpr std::int64_t MultiplyTrunc(std::int64_t value, std::int64_t basisPoints)
+    {
+        // |value| < 2^42 and |basisPoints| < 2^20 can not overflow
+        constexpr std::uint64_t kMaxValue       = 1ull << 42;
+        constexpr std::uint64_t kMaxBasisPoints = 1ull << 20;
+        if (static_cast<std::uint64_t>(value) + kMaxValue < kMaxValue * 2 &&
+            static_cast<std::uint64_t>(basisPoints) + kMaxBasisPoints < kMaxBasisPoints * 2)
+        {
+            return value * basisPoints / k_basisPointsPerOne;
+        }
+
+        return value / k_basisPointsPerOne * basisPoints +
+            value % k_basisPointsPerOne * basisPoints / k_basisPointsPerOne;
+    }
+
+    // value + trunc(value * percent * 0.01)
+    static double MultiplyBuff(double value, double percent)
+    {
+        const auto integer = ToInteger(value);
+        return static_cast<double>(integer + MultiplyTrunc(integer, ToBasisPoints(percent)));
+    }
+};
+
 struct ChanyeFieldCategory
 {
     enum Enum : std::uint8_t
@@ -142,7 +203,27 @@ struct XianRenPropBuff
         }
     }
     template <XianRenPropertyMask PropMask = XianRenPropertyMask::All>
-    XianRenPropBuff Add(const XianRenPropBuff& right)
+    void DecreaseBy(const XianRenPropBuff& right)
+    {
+        if constexpr ((PropMask & XianRenPropertyMask::Li) != XianRenPropertyMask::None)
+        {
+            li_add -= right.li_add;
+            li_percent -= right.li_percent;
+        }
+        if constexpr ((PropMask & XianRenPropertyMask::Nian) != XianRenPropertyMask::None)
+        {
+            nian_add -= right.nian_add;
+            nian_percent -= right.nian_percent;
+        }
+
+        if constexpr ((PropMask & XianRenPropertyMask::Fu) != XianRenPropertyMask::None)
+        {
+            fu_add -= right.fu_add;
+            fu_percent -= right.fu_percent;
+        }
+    }
+    template <XianRenPropertyMask PropMask = XianRenPropertyMask::All>
+    XianRenPropBuff Add(const XianRenPropBuff& right) const
     {
         XianRenPropBuff out(*this);
         out.IncreaseBy<PropMask>(right);
@@ -177,6 +258,20 @@ struct ChanyePropBuff
         }
     }
     template <ChanyePropertyMask PropMask = ChanyePropertyMask::All>
+    void DecreaseBy(const ChanyePropBuff& right)
+    {
+        if constexpr ((PropMask & ChanyePropertyMask::ChanJing) != ChanyePropertyMask::None)
+        {
+            chanJing_add -= right.chanJing_add;
+            chanJing_percent -= right.chanJing_percent;
+        }
+        if constexpr ((PropMask & ChanyePropertyMask::ChanNeng) != ChanyePropertyMask::None)
+        {
+            chanNeng_add -= right.chanNeng_add;
+            chanNeng_percent -= right.chanNeng_percent;
+        }
+    }
+    template <ChanyePropertyMask PropMask = ChanyePropertyMask::All>
     ChanyePropBuff Add(const ChanyePropBuff& right) const
     {
         ChanyePropBuff out(*this);
@@ -228,6 +323,22 @@ struct XianRenProp
         }
     }
     template <XianRenPropertyMask PropMask = XianRenPropertyMask::All>
+    void MultiplyBuffFixedPoint(const XianRenPropBuff& buff)
+    {
+        if constexpr ((PropMask & XianRenPropertyMask::Li) != XianRenPropertyMask::None)
+        {
+            li = FixedPointMath::MultiplyBuff(li, buff.li_percent);
+        }
+        if constexpr ((PropMask & XianRenPropertyMask::Nian) != XianRenPropertyMask::None)
+        {
+            nian = FixedPointMath::MultiplyBuff(nian, buff.nian_percent);
+        }
+        if constexpr ((PropMask & XianRenPropertyMask::Fu) != XianRenPropertyMask::None)
+        {
+            fu = FixedPointMath::MultiplyBuff(fu, buff.fu_percent);
+        }
+    }
+    template <XianRenPropertyMask PropMask = XianRenPropertyMask::All>
     void ApplyBuff(const XianRenPropBuff& buff)
     {
         // Multiply and then add
@@ -235,6 +346,15 @@ struct XianRenProp
         AddBuff<PropMask>(buff);
     }
     template <XianRenPropertyMask PropMask = XianRenPropertyMask::All>
+    void ApplyBuff(const XianRenPropBuff& buff, BuffArithmetic arithmetic)
+    {
+        if (arithmetic == BuffArithmetic::FixedPoint)
+            MultiplyBuffFixedPoint<PropMask>(buff);
+        else
+            MultiplyBuff<PropMask>(buff);
+        AddBuff<PropMask>(buff);
+    }
+    template <XianRenPropertyMask PropMask = XianRenPropertyMask::All>
     void IncreaseBy(const XianRenProp& right)
     {
         if constexpr ((PropMask & XianRenPropertyMask::Li) != XianRenPropertyMask::None)
@@ -309,12 +429,31 @@ struct ChanyeProp
             output += std::trunc(output * buff.chanNeng_percent * 0.01);
         }
     }
+    void MultiplyBuffFixedPoint(const ChanyePropBuff& buff)
+    {
+        if constexpr (ChanyeCat == ChanyeFieldCategory::ChanJing)
+        {
+            output = FixedPointMath::MultiplyBuff(output, buff.chanJing_percent);
+        }
+        else
+        {
+            output = FixedPointMath::MultiplyBuff(output, buff.chanNeng_percent);
+        }
+    }
     void ApplyBuff(const ChanyePropBuff& buff)
     {
         // Multiply and then add
         MultiplyBuff(buff);
         AddBuff(buff);
     }
+    void ApplyBuff(const ChanyePropBuff& buff, BuffArithmetic arithmetic)
+    {
+        if (arithmetic == BuffArithmetic::FixedPoint)
+            MultiplyBuffFixedPoint(buff);
+        else
+            MultiplyBuff(buff);
+        AddBuff(buff);
+    }
     ChanyeProp<ChanyeCat>& operator+=(const ChanyeProp<ChanyeCat>& right)
     {
         output += right.output;
@@ -402,6 +541,19 @@ struct ChanyeFieldData
             std::trunc(xianRenProp.nian * nian_weight) +
             std::trunc(xianRenProp.fu * fu_weight);
     }
+    double CalcBaseOutput(const XianRenProp& xianRenProp, BuffArithmetic arithmetic) const
+    {
+        if (arithmetic != BuffArithmetic::FixedPoint)
+            return CalcBaseOutput(xianRenProp);
+
+        // Weights are ratios, which are exact in basis points as well.
+        auto weightedProp = [](double prop, double weight) -> std::int64_t {
+            return FixedPointMath::MultiplyTrunc(
+                FixedPointMath::ToInteger(prop), FixedPointMath::RatioToBasisPoints(weight));
+        };
+        return static_cast<double>(weightedProp(xianRenProp.li, li_weight) +
+            weightedProp(xianRenProp.nian, nian_weight) + weightedProp(xianRenProp.fu, fu_weight));
+    }
 };
 
 class XianQiFileData
@@ -428,12 +580,18 @@ public:
 
     const std::vector<const GearData*>& GetCalcGearsVec() const { return m_calcGearsVec; }
     std::uint32_t GetMaxNumEquip() const { return m_maxNumEquip; }
+    std::uint32_t GetNumOutputCombs() const { return m_numOutputCombs; }
+    BuffArithmetic GetBuffArithmetic() const { return m_buffArithmetic; }
 
 private:
     std::vector<GearData> m_gearsDataVec;
     std::unordered_map<std::string, const GearData* const> m_loopUpGears;
 
     std::uint32_t m_maxNumEquip = 0;
+    // Number of the best combs to output
+    std::uint32_t m_numOutputCombs = 1;
+    // How percent buffs are applied
+    BuffArithmetic m_buffArithmetic = BuffArithmetic::Floating;
 
     std::vector<const GearData*> m_calcGearsVec;
 };
@@ -0,0 +1,253 @@
+//
+// Author: Jason Huang(jasonhuang1988@gmail.com) 2021
+//
+#include "JUtils/pch.h"
+
+#include "XianRenPropKernel.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define XIANREN_KERNEL_HAS_AVX2 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#else
+#define XIANREN_KERNEL_HAS_AVX2 0
+#endif
+
+// MSVC allows AVX2 intrinsics in any function, gcc and clang need the target to be specified.
+#if XIANREN_KERNEL_HAS_AVX2 && !defined(_MSC_VER)
+#define XIANREN_KERNEL_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define XIANREN_KERNEL_TARGET_AVX2
+#endif
+
+namespace GearCalc
+{
+namespace
+{
+// Sum of final props of a range must stay below this for the final props to be summed in any order.
+constexpr double k_maxExactIntegralSum = 4503599627370496.0; // 2^52
+
+bool IsAvx2Supported()
+{
+#if XIANREN_KERNEL_HAS_AVX2
+#ifdef _MSC_VER
+    int cpuInfo[4] = {};
+    __cpuid(cpuInfo, 0);
+    if (cpuInfo[0] < 7)
+        return false;
+
+    // OSXSAVE and AVX
+    __cpuid(cpuInfo, 1);
+    static constexpr int kOsxSaveAndAvx = (1 << 27) | (1 << 28);
+    if ((cpuInfo[2] & kOsxSaveAndAvx) != kOsxSaveAndAvx)
+        return false;
+
+    // OS saves XMM and YMM registers
+    if ((_xgetbv(0) & 0x6) != 0x6)
+        return false;
+
+    __cpuidex(cpuInfo, 7, 0);
+    return (cpuInfo[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2") != 0;
+#endif
+#else
+    return false;
+#endif
+}
+
+// Same as XianRenProp::ApplyBuff on a single field.
+inline double ApplyBuffScalar(double base, double percent, std::uint32_t add)
+{
+    double out = base;
+    out += std::trunc(out * percent * 0.01);
+    out += add;
+    return out;
+}
+
+#if XIANREN_KERNEL_HAS_AVX2
+// Final props of 4 xian ren starting from index
+XIANREN_KERNEL_TARGET_AVX2 inline __m256d ApplyBuffAvx2(const double* pBase,
+    const double* pStaticPercent, const std::uint32_t* pStaticAdd, __m256d gearPercent,
+    __m128i gearAdd, __m256d hundredth)
+{
+    const __m256d percent = _mm256_add_pd(gearPercent, _mm256_loadu_pd(pStaticPercent));
+    const __m256d base    = _mm256_loadu_pd(pBase);
+
+    // base + trunc(base * percent * 0.01), multiplies are kept separated to match the scalar path.
+    __m256d out = _mm256_mul_pd(_mm256_mul_pd(base, percent), hundredth);
+    out         = _mm256_add_pd(base, _mm256_round_pd(out, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC));
+
+    // Unsigned 32 bit adds wrap as the scalar path, then convert to double by flipping the sign bit
+    // to use the signed conversion.
+    const __m128i add = _mm_add_epi32(
+        gearAdd, _mm_loadu_si128(reinterpret_cast<const __m128i*>(pStaticAdd)));
+    const __m128i addFlipped = _mm_xor_si128(add, _mm_set1_epi32(INT32_MIN));
+    const __m256d addDouble =
+        _mm256_add_pd(_mm256_cvtepi32_pd(addFlipped), _mm256_set1_pd(2147483648.0));
+
+    return _mm256_add_pd(out, addDouble);
+}
+
+XIANREN_KERNEL_TARGET_AVX2 double ApplyBuffAndSumAvx2(const double* pBase,
+    const double* pStaticPercent, const std::uint32_t* pStaticAdd, std::size_t size,
+    double gearPercent, std::uint32_t gearAdd, bool isSumOrderFree)
+{
+    const __m256d gearPercentVec = _mm256_set1_pd(gearPercent);
+    const __m128i gearAddVec     = _mm_set1_epi32(static_cast<int>(gearAdd));
+    const __m256d hundredth      = _mm256_set1_pd(0.01);
+
+    const std::size_t numBlocks = size / 4;
+    double sum                  = 0.0;
+    if (isSumOrderFree)
+    {
+        __m256d sumVec = _mm256_setzero_pd();
+        for (std::size_t block = 0; block < numBlocks; ++block)
+        {
+            const auto i = block * 4;
+            sumVec       = _mm256_add_pd(sumVec, ApplyBuffAvx2(pBase + i, pStaticPercent + i,
+                                           pStaticAdd + i, gearPercentVec, gearAddVec, hundredth));
+        }
+        alignas(32) double lanes[4];
+        _mm256_store_pd(lanes, sumVec);
+        sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    }
+    else
+    {
+        // Accumulate in order of xian ren to be bit exact.
+        alignas(32) double lanes[4];
+        for (std::size_t block = 0; block < numBlocks; ++block)
+        {
+            const auto i = block * 4;
+            _mm256_store_pd(lanes, ApplyBuffAvx2(pBase + i, pStaticPercent + i, pStaticAdd + i,
+                                       gearPercentVec, gearAddVec, hundredth));
+            sum += lanes[0];
+            sum += lanes[1];
+            sum += lanes[2];
+            sum += lanes[3];
+        }
+    }
+
+    for (std::size_t i = numBlocks * 4; i < size; ++i)
+    {
+        sum += ApplyBuffScalar(pBase[i], gearPercent + pStaticPercent[i], gearAdd + pStaticAdd[i]);
+    }
+    return sum;
+}
+#endif
+} // namespace
+
+void XianRenPropKernel::Init(const std::vector<XianRenProp>& basePropVec,
+    const std::vector<XianRenPropBuff>& staticBuffVec, BuffArithmetic arithmetic, bool useSimd)
+{
+    assert(basePropVec.size() == staticBuffVec.size());
+
+    m_size       = basePropVec.size();
+    m_arithmetic = arithmetic;
+    m_useAvx2    = useSimd && IsAvx2Supported();
+
+    auto initField = [&](Field& field, auto getBase, auto getPercent, auto getAdd) {
+        field = Field();
+        field.base.resize(m_size);
+        field.staticPercent.resize(m_size);
+        field.staticAdd.resize(m_size);
+        for (std::size_t i = 0; i < m_size; ++i)
+        {
+            const double base = getBase(basePropVec[i]);
+
+            field.base[i]          = base;
+            field.staticPercent[i] = getPercent(staticBuffVec[i]);
+            field.staticAdd[i]     = getAdd(staticBuffVec[i]);
+
+            field.isIntegral = field.isIntegral && std::trunc(base) == base;
+            field.sumAbsBase += std::abs(base);
+            field.maxAbsStaticPercent =
+                std::max(field.maxAbsStaticPercent, std::abs(field.staticPercent[i]));
+            field.maxStaticAdd = std::max(field.maxStaticAdd, field.staticAdd[i]);
+        }
+
+        if (m_arithmetic == BuffArithmetic::FixedPoint)
+        {
+            field.baseInteger.resize(m_size);
+            field.staticBasisPoints.resize(m_size);
+            for (std::size_t i = 0; i < m_size; ++i)
+            {
+                field.baseInteger[i]       = FixedPointMath::ToInteger(field.base[i]);
+                field.staticBasisPoints[i] = FixedPointMath::ToBasisPoints(field.staticPercent[i]);
+            }
+        }
+    };
+
+    initField(
+        m_li, [](const XianRenProp& prop) { return prop.li; },
+        [](const XianRenPropBuff& buff) { return buff.li_percent; },
+        [](const XianRenPropBuff& buff) { return buff.li_add; });
+    initField(
+        m_nian, [](const XianRenProp& prop) { return prop.nian; },
+        [](const XianRenPropBuff& buff) { return buff.nian_percent; },
+        [](const XianRenPropBuff& buff) { return buff.nian_add; });
+    initField(
+        m_fu, [](const XianRenProp& prop) { return prop.fu; },
+        [](const XianRenPropBuff& buff) { return buff.fu_percent; },
+        [](const XianRenPropBuff& buff) { return buff.fu_add; });
+}
+
+double XianRenPropKernel::ApplyBuffAndSumField(const Field& field, double gearPercent,
+    std::uint32_t gearAdd, std::size_t beginIndex, std::size_t endIndex) const
+{
+    if (m_arithmetic == BuffArithmetic::FixedPoint)
+        return ApplyBuffAndSumFieldFixedPoint(field, gearPercent, gearAdd, beginIndex, endIndex);
+
+    const double* pBase             = field.base.data() + beginIndex;
+    const double* pStaticPercent    = field.staticPercent.data() + beginIndex;
+    const std::uint32_t* pStaticAdd = field.staticAdd.data() + beginIndex;
+    const std::size_t size          = endIndex - beginIndex;
+
+#if XIANREN_KERNEL_HAS_AVX2
+    if (m_useAvx2)
+    {
+        bool isSumOrderFree = false;
+        if (field.isIntegral)
+        {
+            // Upper bound of the sum of final props, the add is bounded by uint32 as it wraps.
+            const double maxAdd = std::min(static_cast<double>(gearAdd) + field.maxStaticAdd,
+                static_cast<double>(UINT32_MAX));
+            const double maxPercent = std::abs(gearPercent) + field.maxAbsStaticPercent;
+            const double maxSum     = field.sumAbsBase * (1.0 + maxPercent * 0.01) +
+                                  maxAdd * static_cast<double>(m_size);
+            isSumOrderFree = maxSum < k_maxExactIntegralSum;
+        }
+        return ApplyBuffAndSumAvx2(
+            pBase, pStaticPercent, pStaticAdd, size, gearPercent, gearAdd, isSumOrderFree);
+    }
+#endif
+
+    double sum = 0.0;
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        sum += ApplyBuffScalar(pBase[i], gearPercent + pStaticPercent[i], gearAdd + pStaticAdd[i]);
+    }
+    return sum;
+}
+
+double XianRenPropKernel::ApplyBuffAndSumFieldFixedPoint(const Field& field, double gearPercent,
+    std::uint32_t gearAdd, std::size_t beginIndex, std::size_t endIndex) const
+{
+    // Percents of the gear and the static buff are both in basis points, so that their sum is the
+    // same as converting the sum of them.
+    const std::int64_t gearBasisPoints = FixedPointMath::ToBasisPoints(gearPercent);
+
+    std::int64_t sum = 0;
+    for (std::size_t i = beginIndex; i < endIndex; ++i)
+    {
+        const std::int64_t base        = field.baseInteger[i];
+        const std::int64_t basisPoints = gearBasisPoints + field.staticBasisPoints[i];
+        const std::uint32_t add        = gearAdd + field.staticAdd[i];
+
+        sum += base + FixedPointMath::MultiplyTrunc(base, basisPoints) + add;
+    }
+    return static_cast<double>(sum);
+}
+} // namespace GearCalc
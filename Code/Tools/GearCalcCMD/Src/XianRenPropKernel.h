@@ -0,0 +1,85 @@
+//
+// Author: Jason Huang(jasonhuang1988@gmail.com) 2021
+//
+#pragma once
+
+#include "GearUserData.h"
+
+namespace GearCalc
+{
+
+// Structure of arrays of xian ren base props and static buffs, so that a gear buff can be applied
+// to many xian ren at once with SIMD (AVX2 if the CPU supports it, otherwise scalar). Results are
+// bit exact to XianRenProp::ApplyBuff of each xian ren with static buff + gear buff, accumulated
+// in order of xian ren. Fixed point arithmetic runs on 64 bit integers instead.
+class XianRenPropKernel
+{
+public:
+    // Xian ren are stored in the order of given vectors.
+    void Init(const std::vector<XianRenProp>& basePropVec,
+        const std::vector<XianRenPropBuff>& staticBuffVec, BuffArithmetic arithmetic,
+        bool useSimd = true);
+
+    // Sum of final props of xian ren in range of [beginIndex, endIndex).
+    template <XianRenPropertyMask PropMask = XianRenPropertyMask::All>
+    XianRenProp ApplyBuffAndSum(
+        const XianRenPropBuff& gearBuff, std::size_t beginIndex, std::size_t endIndex) const
+    {
+        assert(beginIndex <= endIndex && endIndex <= m_size);
+
+        XianRenProp out;
+        if constexpr ((PropMask & XianRenPropertyMask::Li) != XianRenPropertyMask::None)
+        {
+            out.li = ApplyBuffAndSumField(
+                m_li, gearBuff.li_percent, gearBuff.li_add, beginIndex, endIndex);
+        }
+        if constexpr ((PropMask & XianRenPropertyMask::Nian) != XianRenPropertyMask::None)
+        {
+            out.nian = ApplyBuffAndSumField(
+                m_nian, gearBuff.nian_percent, gearBuff.nian_add, beginIndex, endIndex);
+        }
+        if constexpr ((PropMask & XianRenPropertyMask::Fu) != XianRenPropertyMask::None)
+        {
+            out.fu = ApplyBuffAndSumField(
+                m_fu, gearBuff.fu_percent, gearBuff.fu_add, beginIndex, endIndex);
+        }
+        return out;
+    }
+
+    std::size_t GetSize() const { return m_size; }
+    BuffArithmetic GetBuffArithmetic() const { return m_arithmetic; }
+    bool IsUsingAvx2() const { return m_useAvx2; }
+
+private:
+    // One of li, nian, fu of all xian ren
+    struct Field
+    {
+        JUtils::CacheAlignedVector<double> base;
+        JUtils::CacheAlignedVector<double> staticPercent;
+        JUtils::CacheAlignedVector<std::uint32_t> staticAdd;
+
+        // Only for fixed point arithmetic
+        JUtils::CacheAlignedVector<std::int64_t> baseInteger;
+        JUtils::CacheAlignedVector<std::int64_t> staticBasisPoints;
+
+        // When all base props are integers, so are the final props, and their sum is exact in any
+        // order as long as it stays below 2^53. That allows summing SIMD lanes separately.
+        bool isIntegral            = true;
+        double sumAbsBase          = 0.0;
+        double maxAbsStaticPercent = 0.0;
+        std::uint32_t maxStaticAdd = 0;
+    };
+
+    double ApplyBuffAndSumField(const Field& field, double gearPercent, std::uint32_t gearAdd,
+        std::size_t beginIndex, std::size_t endIndex) const;
+    double ApplyBuffAndSumFieldFixedPoint(const Field& field, double gearPercent,
+        std::uint32_t gearAdd, std::size_t beginIndex, std::size_t endIndex) const;
+
+    Field m_li;
+    Field m_nian;
+    Field m_fu;
+    std::size_t m_size          = 0;
+    BuffArithmetic m_arithmetic = BuffArithmetic::Floating;
+    bool m_useAvx2              = false;
+};
+} // namespace GearCalc
@@ -80,6 +80,11 @@ private:
             m_calcSolution = Calculator::Solution::UnorderedTarget;
             return AppState::Running;
         }
+        case 'b':
+        {
+            m_calcSolution = Calculator::Solution::Test;
+            return AppState::Running;
+        }
         case 'q':
             return AppState::Exit;
         case 'c':
@@ -9,10 +9,13 @@
 #include "JUtils/Algorithms.h"
 #include "JUtils/Utils.h"
 
+#include <atomic>
 #include <bitset>
 #include <cmath>
+#include <cstring>
 #include <execution>
 #include <list>
+#include <mutex>
 #include <sstream>
 #include <unordered_map>
 #include <unordered_set>
@@ -21,6 +24,23 @@
 
 #define USE_REMOVE_DUPLICATES false
 #define USE_STD_PAR_FOR_OVERALL_SOLUTION false
+// Build combs of back tracking once for all targets of the overall solution rather than once per
+// target.
+#define USE_SHARED_COMBS_FOR_OVERALL_SOLUTION true
+// Keep combs of back tracking sorted for the overall solution, so that states which can not stay
+// above the target or reach the reference exceed are not visited.
+#define USE_SORTED_PRUNING_FOR_OVERALL_SOLUTION true
+// Skip the combs of the overall solution walk which conflict with the picked inputs by blocks of 64
+// combs, rather than checking them one by one.
+#define USE_CONFLICT_INDEX_FOR_OVERALL_SOLUTION true
+// Search the overall solution as an exact cover of the targets which covers the target with the
+// fewest free combs first, rather than walking the combs in the order of the targets.
+#define USE_EXACT_COVER_FOR_OVERALL_SOLUTION true
+// Use dynamic programming over integer sums for the closest comb of each target when the input
+// values are small enough, otherwise meet in the middle when the inputs are few enough for all
+// subset sums of each half to fit in memory, otherwise fallback to back tracking.
+#define USE_DYNAMIC_PROGRAMMING_FOR_EACH_TARGET true
+#define USE_MEET_IN_THE_MIDDLE_FOR_EACH_TARGET true
 namespace
 {
 using namespace JUtils;
@@ -157,8 +177,25 @@ bool SolutionBestOfEachTarget(const std::vector<const UserData*>& inputVec,
             // Assign target value
             inputDesc.targetValue = pTarget->GetOriginalData();
 
-            if (!Combination::FindSumToTargetBackTracking(inputDesc, errorStr))
+            const bool useDynamicProgramming = USE_DYNAMIC_PROGRAMMING_FOR_EACH_TARGET &&
+                Combination::GetDynamicProgrammingSumSize(inputDesc) <=
+                    Combination::k_maxDynamicProgrammingSumSize;
+            const bool useMeetInTheMiddle = USE_MEET_IN_THE_MIDDLE_FOR_EACH_TARGET &&
+                rawInputVec.size() <= Combination::k_maxMeetInTheMiddleInputSize;
+            if (useDynamicProgramming)
+            {
+                if (!Combination::FindSumToTargetDynamicProgramming(inputDesc, errorStr))
+                    return false;
+            }
+            else if (useMeetInTheMiddle)
+            {
+                if (!Combination::FindSumToTargetMeetInTheMiddle(inputDesc, errorStr))
+                    return false;
+            }
+            else if (!Combination::FindSumToTargetBackTracking(inputDesc, errorStr))
+            {
                 return false;
+            }
         }
 
         // After get the opt, we config the result.
@@ -200,6 +237,556 @@ bool SolutionBestOfEachTarget(const std::vector<const UserData*>& inputVec,
     return ConfigResultListByResults(resultList, errorStr);
 }
 
+// Number of finished targets and exceed sum of the best path found so far, packed into a single
+// atomic so that the walk can read both for pruning without any lock.
+class AtomicIncumbent
+{
+public:
+    struct Value
+    {
+        std::uint32_t numFinishedTarget = 0;
+        float exeedSum                  = 0.0f;
+
+        // A path is recorded if it finishes more targets, or the same number of targets with no
+        // greater exceed sum.
+        bool IsReplacedBy(const Value& other) const
+        {
+            return other.numFinishedTarget > numFinishedTarget ||
+                (other.exeedSum <= exeedSum && other.numFinishedTarget >= numFinishedTarget);
+        }
+    };
+
+    explicit AtomicIncumbent(const Value& value) : m_packed(Pack(value)) {}
+
+    Value Load() const { return Unpack(m_packed.load(std::memory_order_acquire)); }
+
+    // Returns true if the value replaces the incumbent.
+    bool TryReplace(const Value& value)
+    {
+        const auto packed = Pack(value);
+        auto current      = m_packed.load(std::memory_order_acquire);
+        while (Unpack(current).IsReplacedBy(value))
+        {
+            if (m_packed.compare_exchange_weak(current, packed, std::memory_order_acq_rel))
+                return true;
+        }
+        return false;
+    }
+
+    bool IsEqual(const Value& value) const
+    {
+        return m_packed.load(std::memory_order_acquire) == Pack(value);
+    }
+
+private:
+    static std::uint64_t Pack(const Value& value)
+    {
+        std::uint32_t exeedSumBits = 0;
+        std::memcpy(&exeedSumBits, &value.exeedSum, sizeof(exeedSumBits));
+        return (std::uint64_t(value.numFinishedTarget) << 32) | exeedSumBits;
+    }
+
+    static Value Unpack(std::uint64_t packed)
+    {
+        Value value;
+        value.numFinishedTarget  = static_cast<std::uint32_t>(packed >> 32);
+        const auto exeedSumBits = static_cast<std::uint32_t>(packed);
+        std::memcpy(&value.exeedSum, &exeedSumBits, sizeof(exeedSumBits));
+        return value;
+    }
+
+    std::atomic<std::uint64_t> m_packed;
+};
+
+// Inverted bit maps of the combs of a target, in blocks of 64 combs in the order of the combs. Bit
+// k of the map of an input in a block is set if comb k of the block picks the input, so the combs
+// of a block which are free of the picked inputs are found without visiting them.
+class CombConflictIndex
+{
+public:
+    static constexpr std::uint32_t k_blockSizeBits = 6;
+    static constexpr std::uint32_t k_blockSize     = 1u << k_blockSizeBits;
+
+    CombConflictIndex() = default;
+
+    CombConflictIndex(
+        const std::vector<Combination::OutputCombination>& combVec, std::uint32_t inputSize) :
+        m_inputSize(inputSize)
+    {
+        const auto numBlocks = (combVec.size() + k_blockSize - 1) >> k_blockSizeBits;
+        m_bitMaps.assign(numBlocks * inputSize, 0);
+        for (std::size_t i = 0; i < combVec.size(); ++i)
+        {
+            auto* pBlockMaps   = &m_bitMaps[(i >> k_blockSizeBits) * inputSize];
+            const auto combBit = std::uint64_t(1) << (i & (k_blockSize - 1));
+            BitHelper::ForEachSetBit(combVec[i].selectedIndices,
+                [&](std::uint32_t inputIndex) { pBlockMaps[inputIndex] |= combBit; });
+        }
+    }
+
+    // Mask of the combs of the block which pick none of the inputs. Bits after the last comb are
+    // set as well, so callers should bound the comb index.
+    std::uint64_t GetFreeCombMask(std::uint32_t blockIndex, const std::uint32_t* pPickedInputs,
+        std::uint32_t numPickedInputs) const
+    {
+        const auto* pBlockMaps     = &m_bitMaps[std::size_t(blockIndex) * m_inputSize];
+        std::uint64_t conflictMask = 0;
+        for (std::uint32_t i = 0; i < numPickedInputs && conflictMask != ~std::uint64_t(0); ++i)
+            conflictMask |= pBlockMaps[pPickedInputs[i]];
+        return ~conflictMask;
+    }
+
+private:
+    std::uint32_t m_inputSize = 0;
+    std::vector<std::uint64_t> m_bitMaps;
+};
+
+// Sum of the fixed data of the inputs of any indices, from tables of the sums of all subsets of
+// each byte of the indices.
+class InputSumTable
+{
+public:
+    explicit InputSumTable(const std::vector<const UserData*>& inputVec) :
+        m_numChunks(static_cast<std::uint32_t>((inputVec.size() + k_chunkBits - 1) / k_chunkBits)),
+        m_chunkSums(std::size_t(m_numChunks) * k_chunkSize, 0)
+    {
+        for (std::uint32_t chunkIndex = 0; chunkIndex < m_numChunks; ++chunkIndex)
+        {
+            auto* pChunkSums = &m_chunkSums[std::size_t(chunkIndex) * k_chunkSize];
+            for (std::uint32_t mask = 1; mask < k_chunkSize; ++mask)
+            {
+                // Sum of the mask is the sum without its lowest bit plus the input of the bit.
+                const auto inputIndex =
+                    chunkIndex * k_chunkBits + BitHelper::CountTrailingZeros(mask);
+                const auto value =
+                    inputIndex < inputVec.size() ? inputVec[inputIndex]->GetFixedData() : 0;
+                pChunkSums[mask] = pChunkSums[mask & (mask - 1)] + value;
+            }
+        }
+    }
+
+    // Returns true if sum of the inputs of the indices is no less than the value, chunks of the
+    // lower indices are added first.
+    bool IsSumNoLessThan(std::uint64_t indices, std::uint64_t value) const
+    {
+        std::uint64_t sum = 0;
+        for (std::uint32_t chunkIndex = 0; indices != 0; ++chunkIndex, indices >>= k_chunkBits)
+        {
+            assert(chunkIndex < m_numChunks);
+            const auto chunkMask = static_cast<std::uint32_t>(indices & (k_chunkSize - 1));
+            sum += m_chunkSums[std::size_t(chunkIndex) * k_chunkSize + chunkMask];
+            if (sum >= value)
+                return true;
+        }
+        return false;
+    }
+
+private:
+    static constexpr std::uint32_t k_chunkBits = 8;
+    static constexpr std::uint32_t k_chunkSize = 1u << k_chunkBits;
+
+    std::uint32_t m_numChunks = 0;
+    std::vector<std::uint64_t> m_chunkSums;
+};
+
+// Search of a comb for each of the first targets with disjoint inputs, as an exact cover where the
+// targets must be covered once and the inputs at most once. The target with the fewest free combs
+// is covered first rather than in the order of the targets, and the covers are bounded by the
+// exceed sum of the incumbent with the smallest free comb of each uncovered target. Covers of more
+// targets than the incumbent are bounded by the max exceed sum, as the walk does. Targets with the
+// same combs are covered in order with combs of ascending index, as swapping them changes nothing.
+class ExactCoverSearch
+{
+public:
+    using CombVec = std::vector<Combination::OutputCombination>;
+
+    static constexpr auto k_invalidIndex = std::numeric_limits<std::uint32_t>::max();
+
+    ExactCoverSearch(const std::vector<CombVec>& allCombVec,
+        const std::vector<CombConflictIndex>& allConflictIndexVec,
+        const std::vector<std::uint64_t>& targetValueVec, const InputSumTable& inputSumTable,
+        std::uint64_t maxPickedIndices, float maxExeedSum, AtomicIncumbent& incumbent) :
+        m_allCombVec(allCombVec),
+        m_allConflictIndexVec(allConflictIndexVec),
+        m_targetValueVec(targetValueVec),
+        m_inputSumTable(inputSumTable),
+        m_maxPickedIndices(maxPickedIndices),
+        m_maxExeedSum(maxExeedSum),
+        m_incumbent(incumbent),
+        m_beginCombIndexVec(allCombVec.size()),
+        m_prevSameTargetIndexVec(allCombVec.size(), k_invalidIndex)
+    {
+        assert(allCombVec.size() < PickIndex::k_maxInputSize &&
+            allConflictIndexVec.size() == allCombVec.size());
+
+        // Combs are in ascending order of diff, the ones which can not finish the target are
+        // skipped.
+        for (std::size_t i = 0; i < allCombVec.size(); ++i)
+        {
+            const auto& combVec = allCombVec[i];
+            m_beginCombIndexVec[i] = static_cast<std::uint32_t>(
+                std::partition_point(combVec.begin(), combVec.end(),
+                    [](const Combination::OutputCombination& comb) { return comb.diff < 0.0f; }) -
+                combVec.begin());
+        }
+
+        auto isSameComb = [](const Combination::OutputCombination& a,
+                              const Combination::OutputCombination& b) -> bool {
+            return a.selectedIndices == b.selectedIndices && a.diff == b.diff;
+        };
+        for (std::uint32_t i = 1; i < allCombVec.size(); ++i)
+        {
+            for (auto j = i; j-- > 0;)
+            {
+                if (targetValueVec[j] == targetValueVec[i] &&
+                    std::equal(allCombVec[j].begin(), allCombVec[j].end(), allCombVec[i].begin(),
+                        allCombVec[i].end(), isSameComb))
+                {
+                    m_prevSameTargetIndexVec[i] = j;
+                    break;
+                }
+            }
+        }
+    }
+
+    // Search covers of the first numTargets targets which replace the incumbent, indices of combs
+    // of the last one are written to bestIndicesResult. Only the first cover found is recorded if
+    // stopAtFirst. Returns true if any cover is found.
+    bool Run(std::uint32_t numTargets, bool stopAtFirst,
+        std::vector<std::uint32_t>& bestIndicesResult)
+    {
+        assert(numTargets > 0 && numTargets <= m_allCombVec.size());
+
+        m_numTargets         = numTargets;
+        m_allTargets         = PickIndex::GetMaxPickedIndices(numTargets);
+        m_stopAtFirst        = stopAtFirst;
+        m_hasFound           = false;
+        m_pBestIndicesResult = &bestIndicesResult;
+
+        WorkStealingScheduler<CoverTask> scheduler;
+        m_pScheduler = &scheduler;
+        m_firstFreeIndexVecOfWorkers.assign(
+            scheduler.GetNumWorkers(), std::vector<std::uint32_t>(numTargets * numTargets));
+#ifdef M_DEBUG
+        m_numNodesOfWorkers.assign(scheduler.GetNumWorkers(), 0);
+#endif // M_DEBUG
+
+        // Other workers are idle at first, so the root is split as soon as it branches.
+        CoverTask rootTask;
+        rootTask.stackIndexResult.assign(m_allCombVec.size(), k_invalidIndex);
+        scheduler.Push(0, std::move(rootTask));
+        scheduler.Run([&](CoverTask& task, std::uint32_t workerIndex) -> void {
+            if (task.targetIndex == k_invalidIndex)
+                visitNode(task, m_beginCombIndexVec.data(), workerIndex);
+            else
+                branchCombs(task, task.targetIndex, task.beginCombIndex, task.endCombIndex,
+                    task.restLowerBound, task.firstFreeIndexVec.data(), workerIndex);
+        });
+        m_pScheduler = nullptr;
+
+#ifdef M_DEBUG
+        {
+            std::size_t numNodes       = 0;
+            const auto& workerStatsVec = scheduler.GetWorkerStatsVec();
+            for (std::uint32_t i = 0; i < scheduler.GetNumWorkers(); ++i)
+            {
+                const auto& stats = workerStatsVec[i];
+                std::cout << "Worker " << i << " tasks: " << stats.numTasks
+                          << " stolen: " << stats.numStolenTasks
+                          << " pushed: " << stats.numPushedTasks
+                          << " nodes: " << m_numNodesOfWorkers[i] << std::endl;
+                numNodes += m_numNodesOfWorkers[i];
+            }
+            std::cout << "Exact cover of " << numTargets << " targets found: " << m_hasFound
+                      << " nodes: " << numNodes << std::endl;
+        }
+#endif // M_DEBUG
+
+        return m_hasFound;
+    }
+
+private:
+    // A task visits the node of the covered targets, or branches combs in
+    // [beginCombIndex, endCombIndex) of the target which are split from a running search.
+    struct CoverTask
+    {
+        std::vector<std::uint32_t> stackIndexResult;
+        std::uint64_t pickedIndices  = 0;
+        std::uint64_t coveredTargets = 0;
+        float exeedSum               = 0.0f;
+        std::uint32_t targetIndex    = k_invalidIndex;
+        std::uint32_t beginCombIndex = 0;
+        std::uint32_t endCombIndex   = 0;
+        // Sum of the smallest free diff of the other uncovered targets
+        float restLowerBound = 0.0f;
+        // Index of the first free comb of each target
+        std::vector<std::uint32_t> firstFreeIndexVec;
+    };
+
+    // Remaining combs are split to a new task when there are idle workers and less targets than
+    // this are covered, as deeper subtrees are too small to be worth it.
+    static constexpr std::uint32_t k_maxSplitDepth = 4;
+
+    // Free combs of a target are counted up to this, as counting more costs more than it saves on
+    // the sample data. Targets with fewer free combs are covered first, the others in order.
+    static constexpr std::uint32_t k_maxCountedCombs = 2;
+
+    static std::uint32_t GetPickedInputs(std::uint64_t pickedIndices, std::uint32_t* pPickedInputs)
+    {
+        std::uint32_t numPickedInputs = 0;
+        BitHelper::ForEachSetBit(pickedIndices,
+            [&](std::uint32_t inputIndex) { pPickedInputs[numPickedInputs++] = inputIndex; });
+        return numPickedInputs;
+    }
+
+    bool isStopped() const { return m_stopAtFirst && m_hasFound.load(std::memory_order_relaxed); }
+
+    // Exceed sum the covers may reach to replace the incumbent.
+    float getMaxExeedSum() const
+    {
+        const auto ref = m_incumbent.Load();
+        return ref.numFinishedTarget < m_numTargets ? m_maxExeedSum : ref.exeedSum;
+    }
+
+    void outputCover(const CoverTask& task)
+    {
+        const AtomicIncumbent::Value value { m_numTargets, task.exeedSum };
+        if (!m_incumbent.TryReplace(value))
+            return;
+
+        // Another cover may have replaced the incumbent before the lock, which records its own
+        // indices.
+        std::lock_guard lock(m_recordResultMutex);
+        m_hasFound = true;
+        if (m_incumbent.IsEqual(value))
+            *m_pBestIndicesResult = task.stackIndexResult;
+    }
+
+    // Combs before the first free comb of a target at the parent node are not free either. First
+    // free indices of the node are kept in the buffer of the worker at the depth of the node.
+    void visitNode(
+        CoverTask& task, const std::uint32_t* pParentFirstFreeIndices, std::uint32_t workerIndex)
+    {
+        if (isStopped())
+            return;
+#ifdef M_DEBUG
+        ++m_numNodesOfWorkers[workerIndex];
+#endif // M_DEBUG
+
+        const auto uncoveredTargets = m_allTargets ^ task.coveredTargets;
+        if (uncoveredTargets == 0)
+        {
+            outputCover(task);
+            return;
+        }
+
+        // Each covered target takes disjoint inputs of no less sum.
+        std::uint64_t uncoveredTargetSum = 0;
+        BitHelper::ForEachSetBit(uncoveredTargets, [&](std::uint32_t targetIndex) {
+            uncoveredTargetSum += m_targetValueVec[targetIndex];
+        });
+        if (!m_inputSumTable.IsSumNoLessThan(
+                task.pickedIndices ^ m_maxPickedIndices, uncoveredTargetSum))
+            return;
+
+        const auto maxExeedSum = getMaxExeedSum();
+        if (task.exeedSum > maxExeedSum)
+            return;
+
+        std::uint32_t pickedInputs[64];
+        const auto numPickedInputs = GetPickedInputs(task.pickedIndices, pickedInputs);
+
+        // Covered targets keep the first free indices of the parent.
+        const auto depth        = BitHelper::PopCount(task.coveredTargets);
+        auto* pFirstFreeIndices = &m_firstFreeIndexVecOfWorkers[workerIndex][depth * m_numTargets];
+        std::copy_n(pParentFirstFreeIndices, m_numTargets, pFirstFreeIndices);
+
+        // Find the uncovered target with the fewest free combs within the exceed sum, counting
+        // stops at the fewest so far as only the smallest free diff is needed after it. The node is
+        // pruned as soon as the smallest free diffs of the targets exceed the rest exceed sum.
+        constexpr auto kBlockSizeBits = CombConflictIndex::k_blockSizeBits;
+        constexpr auto kBlockMask     = CombConflictIndex::k_blockSize - 1;
+        std::uint32_t bestTargetIndex = k_invalidIndex;
+        std::uint32_t bestNumCombs    = k_maxCountedCombs;
+        float bestMinDiff             = 0.0f;
+        float lowerBound              = 0.0f;
+        const auto maxDiff            = maxExeedSum - task.exeedSum;
+        for (auto remainTargets = uncoveredTargets; remainTargets != 0;
+             remainTargets &= remainTargets - 1)
+        {
+            const auto targetIndex    = BitHelper::CountTrailingZeros(remainTargets);
+            const auto& combVec       = m_allCombVec[targetIndex];
+            const auto& conflictIndex = m_allConflictIndexVec[targetIndex];
+            const auto numAllCombs    = static_cast<std::uint32_t>(combVec.size());
+
+            // A target is covered after the previous one of the same combs with a later comb, only
+            // the smallest free diff is needed before.
+            auto beginIndex           = pParentFirstFreeIndices[targetIndex];
+            bool canCover             = true;
+            const auto prevSameTarget = m_prevSameTargetIndexVec[targetIndex];
+            if (prevSameTarget != k_invalidIndex)
+            {
+                const auto prevCombIndex = task.stackIndexResult[prevSameTarget];
+                if (prevCombIndex == k_invalidIndex)
+                    canCover = false;
+                else
+                    beginIndex = std::max(beginIndex, prevCombIndex + 1);
+            }
+            const auto maxNumCombs = canCover ? bestNumCombs : 1;
+
+            // Combs of a block are counted even if some of them exceed, as it only decides the
+            // order of the targets.
+            std::uint32_t numCombs       = 0;
+            std::uint32_t firstFreeIndex = k_invalidIndex;
+            for (auto blockIndex = beginIndex >> kBlockSizeBits;
+                 (blockIndex << kBlockSizeBits) < numAllCombs && numCombs < maxNumCombs &&
+                 combVec[blockIndex << kBlockSizeBits].diff <= maxDiff - lowerBound;
+                 ++blockIndex)
+            {
+                auto freeMask =
+                    conflictIndex.GetFreeCombMask(blockIndex, pickedInputs, numPickedInputs);
+                if ((blockIndex << kBlockSizeBits) < beginIndex)
+                    freeMask &= ~std::uint64_t(0) << (beginIndex & kBlockMask);
+                if (((blockIndex + 1) << kBlockSizeBits) > numAllCombs)
+                    freeMask &= ~(~std::uint64_t(0) << (numAllCombs & kBlockMask));
+                if (freeMask == 0)
+                    continue;
+
+                if (firstFreeIndex == k_invalidIndex)
+                    firstFreeIndex =
+                        (blockIndex << kBlockSizeBits) + BitHelper::CountTrailingZeros(freeMask);
+                numCombs += BitHelper::PopCount(freeMask);
+            }
+
+            // The target can not be covered any more within the exceed sum.
+            if (firstFreeIndex == k_invalidIndex)
+                return;
+            const auto minDiff = combVec[firstFreeIndex].diff;
+            lowerBound += minDiff;
+            if (lowerBound > maxDiff)
+                return;
+
+            pFirstFreeIndices[targetIndex] = firstFreeIndex;
+            if (canCover && (numCombs < bestNumCombs || bestTargetIndex == k_invalidIndex))
+            {
+                bestTargetIndex = targetIndex;
+                bestNumCombs    = numCombs;
+                bestMinDiff     = minDiff;
+            }
+        }
+
+        // Combs of the target after the end can not replace the incumbent with the other targets.
+        const auto& bestCombVec   = m_allCombVec[bestTargetIndex];
+        const auto restLowerBound = lowerBound - bestMinDiff;
+        const auto beginIndex     = pFirstFreeIndices[bestTargetIndex];
+        const auto endIndex       = static_cast<std::uint32_t>(
+            std::upper_bound(bestCombVec.begin() + beginIndex, bestCombVec.end(),
+                maxDiff - restLowerBound,
+                [](float diff, const Combination::OutputCombination& comb) -> bool {
+                    return diff < comb.diff;
+                }) -
+            bestCombVec.begin());
+
+        branchCombs(task, bestTargetIndex, beginIndex, endIndex, restLowerBound, pFirstFreeIndices,
+            workerIndex);
+    }
+
+    void branchCombs(CoverTask& task, std::uint32_t targetIndex, std::uint32_t beginCombIndex,
+        std::uint32_t endCombIndex, float restLowerBound, const std::uint32_t* pFirstFreeIndices,
+        std::uint32_t workerIndex)
+    {
+        const auto& combVec       = m_allCombVec[targetIndex];
+        const auto& conflictIndex = m_allConflictIndexVec[targetIndex];
+        const auto targetBit      = std::uint64_t(1) << targetIndex;
+
+        std::uint32_t pickedInputs[64];
+        const auto numPickedInputs = GetPickedInputs(task.pickedIndices, pickedInputs);
+
+        // Returns false if the rest combs can not replace the incumbent.
+        auto branchComb = [&](std::uint32_t i) -> bool {
+            const auto& comb = combVec[i];
+            if (isStopped() || task.exeedSum + comb.diff + restLowerBound > getMaxExeedSum())
+                return false;
+
+            // Publish the remaining combs to the idle workers.
+            if (BitHelper::PopCount(task.coveredTargets) < k_maxSplitDepth &&
+                i + 1 < endCombIndex && m_pScheduler->HasIdleWorkers())
+            {
+                auto splitTask           = task;
+                splitTask.targetIndex    = targetIndex;
+                splitTask.beginCombIndex = i + 1;
+                splitTask.endCombIndex   = endCombIndex;
+                splitTask.restLowerBound = restLowerBound;
+                splitTask.firstFreeIndexVec.assign(
+                    pFirstFreeIndices, pFirstFreeIndices + m_numTargets);
+                m_pScheduler->Push(workerIndex, std::move(splitTask));
+                endCombIndex = i + 1;
+            }
+
+            const auto prevExeedSum            = task.exeedSum;
+            task.stackIndexResult[targetIndex] = i;
+            task.pickedIndices |= comb.selectedIndices;
+            task.coveredTargets |= targetBit;
+            task.exeedSum += comb.diff;
+
+            visitNode(task, pFirstFreeIndices, workerIndex);
+
+            task.stackIndexResult[targetIndex] = k_invalidIndex;
+            task.pickedIndices ^= comb.selectedIndices;
+            task.coveredTargets ^= targetBit;
+            task.exeedSum = prevExeedSum;
+            return true;
+        };
+
+        // Only the free combs of each block are branched, in ascending order of diff.
+        constexpr auto kBlockSizeBits = CombConflictIndex::k_blockSizeBits;
+        constexpr auto kBlockMask     = CombConflictIndex::k_blockSize - 1;
+        for (auto blockIndex = beginCombIndex >> kBlockSizeBits;
+             (blockIndex << kBlockSizeBits) < endCombIndex; ++blockIndex)
+        {
+            auto freeMask =
+                conflictIndex.GetFreeCombMask(blockIndex, pickedInputs, numPickedInputs);
+            if ((blockIndex << kBlockSizeBits) < beginCombIndex)
+                freeMask &= ~std::uint64_t(0) << (beginCombIndex & kBlockMask);
+
+            // End may be tightened by a split while branching the block.
+            while (freeMask != 0)
+            {
+                const auto i =
+                    (blockIndex << kBlockSizeBits) + BitHelper::CountTrailingZeros(freeMask);
+                if (i >= endCombIndex || !branchComb(i))
+                    return;
+                freeMask &= freeMask - 1;
+            }
+        }
+    }
+
+    const std::vector<CombVec>& m_allCombVec;
+    const std::vector<CombConflictIndex>& m_allConflictIndexVec;
+    const std::vector<std::uint64_t>& m_targetValueVec;
+    const InputSumTable& m_inputSumTable;
+    const std::uint64_t m_maxPickedIndices;
+    const float m_maxExeedSum;
+    AtomicIncumbent& m_incumbent;
+    std::vector<std::uint32_t> m_beginCombIndexVec;
+    // Index of the previous target with the same combs, or invalid
+    std::vector<std::uint32_t> m_prevSameTargetIndexVec;
+
+    // States of the running search
+    std::uint32_t m_numTargets                       = 0;
+    std::uint64_t m_allTargets                       = 0;
+    bool m_stopAtFirst                               = false;
+    std::atomic<bool> m_hasFound                     = false;
+    std::vector<std::uint32_t>* m_pBestIndicesResult = nullptr;
+    WorkStealingScheduler<CoverTask>* m_pScheduler   = nullptr;
+    std::mutex m_recordResultMutex;
+    // First free indices of the nodes of each depth, for each worker
+    std::vector<std::vector<std::uint32_t>> m_firstFreeIndexVecOfWorkers;
+#ifdef M_DEBUG
+    std::vector<std::size_t> m_numNodesOfWorkers;
+#endif // M_DEBUG
+};
+
 // TODO: Need research to find out a better algorithm. Such as A* path finding or simple Dijkstra.
 bool SolutionBestOverral(const std::vector<const UserData*>& inputVec,
     const std::vector<const UserData*>& targetVec, ResultDataList& resultList,
@@ -252,6 +839,9 @@ bool SolutionBestOverral(const std::vector<const UserData*>& inputVec,
             }
         }
 
+        // Each finished target takes inputs of its own.
+        optimizedTargetSize = std::min(optimizedTargetSize, inputSize);
+
 #ifdef M_DEBUG
         {
             auto str = FormatString("inputSum: ", inputSum, " targetSum: ", targetSum,
@@ -333,13 +923,26 @@ bool SolutionBestOverral(const std::vector<const UserData*>& inputVec,
         std::vector<std::string> allErrorStrVec(optimizedTargetSize);
         std::atomic<bool> hasError = false;
 
-        static constexpr bool s_kUseHashTable = !USE_REMOVE_DUPLICATES;
+        static constexpr auto s_kCombDeduplication = USE_REMOVE_DUPLICATES
+            ? Combination::CombDeduplication::None
+            : Combination::CombDeduplication::CanonicalMultiset;
 
         // Make the raw input vec, as we are using the same one.
         std::vector<std::uint64_t> rawInputVec(orderedInputVec.size());
         std::transform(orderedInputVec.begin(), orderedInputVec.end(), rawInputVec.begin(),
             [](const UserData* element) { return element->GetFixedData(); });
 
+#if USE_SHARED_COMBS_FOR_OVERALL_SOLUTION
+        {
+            std::vector<std::uint64_t> rawTargetVec(optimizedTargetSize);
+            for (std::uint32_t i = 0; i < optimizedTargetSize; ++i)
+                rawTargetVec[i] = targetVec[i]->GetOriginalData();
+
+            hasError = !Combination::FindSumToTargetsBackTracking<s_kCombDeduplication,
+                USE_SORTED_PRUNING_FOR_OVERALL_SOLUTION>(rawInputVec, rawTargetVec,
+                resultList.m_unitScale, allCombVec, refMinExeedSum, allErrorStrVec[0]);
+        }
+#else
         auto taskFunc = [&](std::uint32_t targetIndex) {
             // Init input desc
             Combination::InputSumToTargetDesc<std::uint64_t> inputDesc(rawInputVec,
@@ -347,7 +950,8 @@ bool SolutionBestOverral(const std::vector<const UserData*>& inputVec,
                 &allCombVec[targetIndex], refMinExeedSum);
 
             hasError = hasError ||
-                !Combination::FindSumToTargetBackTracking<s_kUseHashTable>(
+                !Combination::FindSumToTargetBackTracking<s_kCombDeduplication,
+                    USE_SORTED_PRUNING_FOR_OVERALL_SOLUTION>(
                     inputDesc, allErrorStrVec[targetIndex]);
         };
 
@@ -368,6 +972,7 @@ bool SolutionBestOverral(const std::vector<const UserData*>& inputVec,
                 threadPool.enqueue_work(taskFunc, i);
             }
         }
+#endif
 #endif
 
         // Sync the error results
@@ -384,78 +989,203 @@ bool SolutionBestOverral(const std::vector<const UserData*>& inputVec,
         }
     }
 
-    // Secondly, walk through all combs to find the best result
-#ifdef M_DEBUG
-    std::atomic<std::size_t> pathSize = 0;
-#endif // M_DEBUG
+#if USE_CONFLICT_INDEX_FOR_OVERALL_SOLUTION || USE_EXACT_COVER_FOR_OVERALL_SOLUTION
+    // Combs of the first target are walked one by one, so they need no index unless any target may
+    // be covered first.
+    std::vector<CombConflictIndex> allConflictIndexVec(optimizedTargetSize);
+    for (std::uint32_t i = USE_EXACT_COVER_FOR_OVERALL_SOLUTION ? 0 : 1; i < optimizedTargetSize;
+         ++i)
+        allConflictIndexVec[i] =
+            CombConflictIndex(allCombVec[i], static_cast<std::uint32_t>(inputSize));
+#endif
 
+    // Secondly, walk through all combs to find the best result
     std::vector<std::uint32_t> bestIndicesResult;
     constexpr auto kInvalidIndex = GetInvalidValue(sizeof(std::uint32_t) * 8);
+
+    // Pruning reads the incumbent without lock, the mutex is only taken to record the indices of
+    // a path which replaces it.
+    AtomicIncumbent incumbent({ refMaxNumFinishedTarget, refMinExeedSum });
     std::mutex recordResultMutex;
 
     // Config max picked table by removing the bits from left most to match number of inputs
     const auto maxPickedIndices = PickIndex::GetMaxPickedIndices(inputSize);
 
+    // Sum of remaining inputs is looked up to check if a target can still be finished.
+    const InputSumTable inputSumTable(orderedInputVec);
+
+#if USE_EXACT_COVER_FOR_OVERALL_SOLUTION
+    if (!allCombVec.empty())
+    {
+        std::vector<std::uint64_t> targetValueVec(optimizedTargetSize);
+        for (std::uint32_t i = 0; i < optimizedTargetSize; ++i)
+            targetValueVec[i] = targetVec[i]->GetOriginalData();
+
+        ExactCoverSearch search(allCombVec, allConflictIndexVec, targetValueVec, inputSumTable,
+            maxPickedIndices, refMinExeedSum, incumbent);
+
+        // A cover of more targets within the reference exceed sum replaces the incumbent whatever
+        // its exceed sum is, so the first cover found is enough until there is none of more
+        // targets.
+        auto numTargets = refMaxNumFinishedTarget;
+        while (numTargets < optimizedTargetSize &&
+            search.Run(numTargets + 1, true, bestIndicesResult))
+            ++numTargets;
+
+        // Then search the cover of the least exceed sum of the most targets.
+        search.Run(numTargets, false, bestIndicesResult);
+
+        refMaxNumFinishedTarget = incumbent.Load().numFinishedTarget;
+    }
+#else
     if (!allCombVec.empty())
     {
         // All combs Traversal, from combs of first target for parallel execution.
         auto& firstCombVec = allCombVec.front();
 
-        auto taskFunc = [&](auto& index) -> void {
-            // Avoid to copy vector, we use a stack vector to store results
-            std::vector<std::uint32_t> stackIndexResult(optimizedTargetSize);
+        // A task walks a comb of the first target, or combs in [beginCombIndex, endCombIndex) of
+        // the target which are split from a running walk. Indices of combs of previous targets
+        // are in the stack.
+        struct WalkTask
+        {
+            std::vector<std::uint32_t> stackIndexResult;
+            std::uint64_t pickedIndices  = 0;
+            std::uint32_t targetIndex    = 0;
+            float prevExeed              = 0.0f;
+            std::uint32_t beginCombIndex = 0;
+            std::uint32_t endCombIndex   = 0;
+        };
+
+        // Remaining combs of a target before this are split to a new task when there are idle
+        // workers, as the subtrees of deeper targets are too small to be worth it.
+        static constexpr std::uint32_t kMaxSplitTargetIndex = 4;
+
+        WorkStealingScheduler<WalkTask> scheduler;
+#ifdef M_DEBUG
+        std::vector<std::size_t> numPathsOfWorkers(scheduler.GetNumWorkers());
+#endif // M_DEBUG
 
-            // Invalidate all indices of stackIndexResult
-            std::fill(stackIndexResult.begin(), stackIndexResult.end(), kInvalidIndex);
+        auto taskFunc = [&](WalkTask& task, std::uint32_t workerIndex) -> void {
+            // Avoid to copy vector, we use a stack vector to store results
+            auto& stackIndexResult = task.stackIndexResult;
 
             auto outputPath = [&](std::uint32_t maxNumFinishedTarget, float exeedSum) -> void {
+#ifdef M_DEBUG
+                ++numPathsOfWorkers[workerIndex];
+#endif // M_DEBUG
+                const AtomicIncumbent::Value value { maxNumFinishedTarget, exeedSum };
+                if (!incumbent.TryReplace(value))
+                    return;
+
+                // Another path may have replaced the incumbent before the lock, which records its
+                // own indices.
                 std::lock_guard lock(recordResultMutex);
-                bool needToRecord = maxNumFinishedTarget > refMaxNumFinishedTarget ||
-                    (exeedSum <= refMinExeedSum && maxNumFinishedTarget >= refMaxNumFinishedTarget);
+                if (incumbent.IsEqual(value))
+                    bestIndicesResult = stackIndexResult;
+            };
+
+            // Walk combs in [beginCombIndex, endCombIndex) of the target, picked is true if any
+            // comb of the target is already picked.
+            auto walkCombs = [&](auto& walk, std::uint64_t pickedIndices, std::uint32_t targetIndex,
+                                 float prevExeed, std::uint32_t beginCombIndex,
+                                 std::uint32_t endCombIndex, bool picked) -> void {
+                const auto& currentCombVec = allCombVec[targetIndex];
+                auto walkComb              = [&](std::uint32_t i) -> void {
+                    auto& currentComb = currentCombVec[i];
+
+                    // Skip comb that can not finish the target
+                    if (currentComb.diff < 0.0f)
+                        return;
+
+                    // Publish the remaining combs to the idle workers.
+                    if (targetIndex < kMaxSplitTargetIndex && i + 1 < endCombIndex &&
+                        scheduler.HasIdleWorkers())
+                    {
+                        scheduler.Push(workerIndex, { stackIndexResult, pickedIndices, targetIndex,
+                                                        prevExeed, i + 1, endCombIndex });
+                        endCombIndex = i + 1;
+                    }
 
-                if (needToRecord)
+                    // Save current result.
+                    stackIndexResult[targetIndex] = i;
+                    picked                        = true;
+
+                    walk(pickedIndices | currentComb.selectedIndices, targetIndex + 1,
+                        prevExeed + currentComb.diff);
+
+                    // Reset current result.
+                    stackIndexResult[targetIndex] = kInvalidIndex;
+                };
+
+#if USE_CONFLICT_INDEX_FOR_OVERALL_SOLUTION
+                // Only the free combs of each block are visited, in the order of the combs.
+                constexpr auto kBlockSizeBits = CombConflictIndex::k_blockSizeBits;
+                constexpr auto kBlockMask     = CombConflictIndex::k_blockSize - 1;
+                const auto& conflictIndex     = allConflictIndexVec[targetIndex];
+                std::uint32_t pickedInputs[64];
+                std::uint32_t numPickedInputs = 0;
+                BitHelper::ForEachSetBit(pickedIndices, [&](std::uint32_t inputIndex) {
+                    pickedInputs[numPickedInputs++] = inputIndex;
+                });
+
+                for (auto blockIndex = beginCombIndex >> kBlockSizeBits;
+                     (blockIndex << kBlockSizeBits) < endCombIndex; ++blockIndex)
+                {
+                    auto freeMask =
+                        conflictIndex.GetFreeCombMask(blockIndex, pickedInputs, numPickedInputs);
+                    // Skip the combs before the begin of the range in the first block.
+                    if ((blockIndex << kBlockSizeBits) < beginCombIndex)
+                        freeMask &= ~std::uint64_t(0) << (beginCombIndex & kBlockMask);
+
+                    // End may be tightened by a split while walking the block.
+                    while (freeMask != 0)
+                    {
+                        const auto i = (blockIndex << kBlockSizeBits) +
+                            BitHelper::CountTrailingZeros(freeMask);
+                        if (i >= endCombIndex)
+                            break;
+                        freeMask &= freeMask - 1;
+                        walkComb(i);
+                    }
+                }
+#else
+                for (auto i = beginCombIndex; i < endCombIndex; ++i)
                 {
-                    refMaxNumFinishedTarget = maxNumFinishedTarget;
-                    refMinExeedSum          = exeedSum;
+                    // Skip already picked indices
+                    if ((pickedIndices & currentCombVec[i].selectedIndices) == 0)
+                        walkComb(i);
+                }
+#endif
 
-                    bestIndicesResult = stackIndexResult;
+                if (!picked)
+                {
+                    outputPath(targetIndex, prevExeed);
                 }
-#ifdef M_DEBUG
-                ++pathSize;
-#endif // M_DEBUG
             };
 
             auto walkRecursion =
                 LambdaCombinator([&](auto& selfLambda, std::uint64_t pickedIndices,
                                      std::uint32_t targetIndex, float prevExeed) -> void {
+                    const auto ref = incumbent.Load();
+
                     // We reached the end of the tree
                     if (pickedIndices == maxPickedIndices || targetIndex >= optimizedTargetSize)
                     {
                         outputPath(targetIndex, prevExeed);
                         return;
                     }
-                    else if (targetIndex + 1 > refMaxNumFinishedTarget)
+                    else if (targetIndex + 1 > ref.numFinishedTarget)
                     {
 
                         // At this point, we still have unpicked indices and still have targets to
                         // finish. and num finished target might be greater
 
                         // We make a prediction to see remianing indices are enough to finish this
-                        // target.
-                        auto remianIndices            = pickedIndices ^ maxPickedIndices;
-                        std::uint64_t sum             = 0;
-                        bool canFinish                = false;
-                        const auto& currentTargetData = targetVec[targetIndex]->GetOriginalData();
-                        ParseIndicesToUserData(
-                            orderedInputVec, remianIndices, [&](const UserData* pUserData) {
-                                sum += pUserData->GetFixedData();
-                                if (sum >= currentTargetData)
-                                {
-                                    canFinish = true;
-                                    return false;
-                                }
-                                return true;
-                            });
+                        // target. Inputs are in descending order, so the first chunks are
+                        // usually enough.
+                        const auto remainIndices = pickedIndices ^ maxPickedIndices;
+                        const bool canFinish     = inputSumTable.IsSumNoLessThan(
+                            remainIndices, targetVec[targetIndex]->GetOriginalData());
 
                         // if the prediction we have made can not finish the target, then we just
                         // end this path.
@@ -482,7 +1212,7 @@ bool SolutionBestOverral(const std::vector<const UserData*>& inputVec,
                         // finish. But num finished target can not be greater.
 
                         // We check prevExeed to see if we can skip
-                        if (prevExeed > refMinExeedSum)
+                        if (prevExeed > ref.exeedSum)
                         {
                             outputPath(targetIndex, prevExeed);
                             return;
@@ -491,7 +1221,7 @@ bool SolutionBestOverral(const std::vector<const UserData*>& inputVec,
 
                     const auto& currentCombVec = allCombVec[targetIndex];
                     // Skip if exeed sum already greater than the sum of previous full path.
-                    const auto _refMinExeedSum = refMinExeedSum;
+                    const auto _refMinExeedSum = ref.exeedSum;
                     auto endCombIndex =
                         std::upper_bound(currentCombVec.begin(), currentCombVec.end(), prevExeed,
                             [&](float prevSum, const Combination::OutputCombination& comb) -> bool {
@@ -499,72 +1229,62 @@ bool SolutionBestOverral(const std::vector<const UserData*>& inputVec,
                             }) -
                         currentCombVec.begin();
 
-                    bool picked = false;
-                    for (std::uint32_t i = 0; i < endCombIndex; ++i)
-                    {
-                        auto& currentComb = currentCombVec[i];
-
-                        // Skip already picked indices and comb that can not finish the target
-                        if ((pickedIndices & currentComb.selectedIndices) != 0 ||
-                            currentComb.diff < 0.0f)
-                            continue;
-
-                        // Save current result.
-                        stackIndexResult[targetIndex] = i;
-                        picked                        = true;
-
-                        selfLambda(pickedIndices | currentComb.selectedIndices, targetIndex + 1,
-                            prevExeed + currentComb.diff);
-
-                        // Reset current result.
-                        stackIndexResult[targetIndex] = kInvalidIndex;
-                    }
-
-                    if (!picked)
-                    {
-                        outputPath(targetIndex, prevExeed);
-                    }
+                    walkCombs(selfLambda, pickedIndices, targetIndex, prevExeed, 0,
+                        static_cast<std::uint32_t>(endCombIndex), false);
                 });
 
+            // Resume the combs split from a running walk.
+            if (task.targetIndex > 0)
+            {
+                walkCombs(walkRecursion, task.pickedIndices, task.targetIndex, task.prevExeed,
+                    task.beginCombIndex, task.endCombIndex, true);
+                return;
+            }
+
             // Pick the indices of each comb from first comb vec.
-            auto& comb = firstCombVec[index];
-            if (comb.diff < refMinExeedSum)
+            const auto index = task.beginCombIndex;
+            auto& comb       = firstCombVec[index];
+            if (comb.diff < incumbent.Load().exeedSum)
             {
                 stackIndexResult[0] = index;
                 walkRecursion(comb.selectedIndices, 1, comb.diff);
             }
         };
 
-        // Upper bound returns the right most index of comb that has diff greater than
-        // refMinExeedSum, which we don't need to calculate anymore.
-        auto endIndexFirstComb = static_cast<std::uint32_t>(firstCombVec.size());
-
-#if USE_STD_PAR_FOR_OVERALL_SOLUTION
+        // Combs of the first target are distributed to the workers in turn, and pushed in reverse
+        // so that each worker starts from its first comb.
+        const auto numFirstCombs = static_cast<std::uint32_t>(firstCombVec.size());
+        for (auto i = numFirstCombs; i-- > 0;)
         {
-            // Gen indices, as we need index in std::for_each
-            std::vector<std::uint32_t> firstCombIndices;
-            firstCombIndices.reserve(endIndexFirstComb);
-            for (std::uint32_t i = 0; i < endIndexFirstComb; ++i)
-                firstCombIndices.emplace_back(i);
-
-            std::for_each(
-                std::execution::par, firstCombIndices.begin(), firstCombIndices.end(), taskFunc);
+            WalkTask task;
+            task.stackIndexResult.assign(optimizedTargetSize, kInvalidIndex);
+            task.beginCombIndex = i;
+            task.endCombIndex   = i + 1;
+            scheduler.Push(i % scheduler.GetNumWorkers(), std::move(task));
         }
-#else
+        scheduler.Run(taskFunc);
+
+#ifdef M_DEBUG
         {
-            vorbrodt::thread_pool threadPool;
-            for (std::uint32_t i = 0; i < endIndexFirstComb; ++i)
+            std::size_t numPaths = 0;
+            const auto& workerStatsVec = scheduler.GetWorkerStatsVec();
+            for (std::uint32_t i = 0; i < scheduler.GetNumWorkers(); ++i)
             {
-                threadPool.enqueue_work(taskFunc, i);
+                const auto& stats = workerStatsVec[i];
+                std::cout << "Worker " << i << " tasks: " << stats.numTasks
+                          << " stolen: " << stats.numStolenTasks
+                          << " pushed: " << stats.numPushedTasks
+                          << " paths: " << numPathsOfWorkers[i] << std::endl;
+                numPaths += numPathsOfWorkers[i];
             }
+            std::cout << "Total number of path: " << numPaths << std::endl;
         }
-#endif // USE_STD_PAR_FOR_OVERALL_SOLUTION
-    }
-
-#ifdef M_DEBUG
-    std::cout << "Total number of path: " << pathSize << std::endl;
 #endif // M_DEBUG
 
+        refMaxNumFinishedTarget = incumbent.Load().numFinishedTarget;
+    }
+#endif
+
     // If did not find any path that is better then ref solution we out put the ref result.
     if (bestIndicesResult.empty())
         return true;
@@ -643,6 +1363,89 @@ bool SolutionBestOverral(const std::vector<const UserData*>& inputVec,
     return ConfigResultListByResults(resultList, errorStr);
 }
 } // namespace Solutions
+
+namespace UnitTest
+{
+// Time spent on back tracking with the de-duplication and the comb table, or a negative value on
+// error.
+template <Combination::CombDeduplication Deduplication, bool UseSortedPruning = false,
+    typename TypeCombTable = PreHashedFlatSet>
+double TimeBackTracking(
+    const Combination::InputSumToTargetDesc<std::uint64_t>& inputDesc, std::string& errorStr)
+{
+    Timer timer;
+    if (!Combination::FindSumToTargetBackTracking<Deduplication, UseSortedPruning, 32,
+            std::uint64_t, TypeCombTable>(inputDesc, errorStr))
+        return -1.0;
+    return timer.DurationInSec();
+}
+
+// Micro benchmark of the de-duplications and the sorted pruning of back tracking on the loaded
+// data, which finds all combs of each target as SolutionBestOverral does. Results of all of them
+// must be the same.
+bool BenchmarkCombTables(const std::vector<const UserData*>& inputVec,
+    const std::vector<const UserData*>& targetVec, std::uint64_t unitScale, std::string& errorStr)
+{
+    using CombDeduplication = Combination::CombDeduplication;
+
+    auto orderedInputVec = inputVec;
+    std::sort(std::execution::par_unseq, orderedInputVec.begin(), orderedInputVec.end(),
+        [&](const UserData* a, const UserData* b) -> bool { return *a > *b; });
+
+    std::vector<std::uint64_t> rawInputVec(orderedInputVec.size());
+    std::transform(orderedInputVec.begin(), orderedInputVec.end(), rawInputVec.begin(),
+        [](const UserData* element) { return element->GetFixedData(); });
+
+    static constexpr std::size_t kNumMethods = 4;
+    static constexpr const char* kMethodNames[kNumMethods] = { "PreHashedFlatSet",
+        "PreHashedStdSet", "CanonicalMultiset", "SortedPruning" };
+
+    double timeSums[kNumMethods] = {};
+    for (const auto* pTarget : targetVec)
+    {
+        std::uint64_t closestCombs[kNumMethods] = {};
+        std::vector<Combination::OutputCombination> combVecs[kNumMethods];
+        double times[kNumMethods] = {};
+
+        const auto targetValue = pTarget->GetOriginalData();
+        times[0] = TimeBackTracking<CombDeduplication::HashTable, false, PreHashedFlatSet>(
+            { rawInputVec, targetValue, unitScale, &closestCombs[0], &combVecs[0] }, errorStr);
+        times[1] = TimeBackTracking<CombDeduplication::HashTable, false, PreHashedStdSet>(
+            { rawInputVec, targetValue, unitScale, &closestCombs[1], &combVecs[1] }, errorStr);
+        times[2] = TimeBackTracking<CombDeduplication::CanonicalMultiset>(
+            { rawInputVec, targetValue, unitScale, &closestCombs[2], &combVecs[2] }, errorStr);
+        times[3] = TimeBackTracking<CombDeduplication::CanonicalMultiset, true>(
+            { rawInputVec, targetValue, unitScale, &closestCombs[3], &combVecs[3] }, errorStr);
+
+        std::cout << "Target: " << pTarget->GetDesc() << " Size of combs: " << combVecs[0].size();
+        for (std::size_t i = 0; i < kNumMethods; ++i)
+        {
+            if (times[i] < 0.0)
+                return false;
+
+            if (closestCombs[i] != closestCombs[0] || combVecs[i].size() != combVecs[0].size())
+            {
+                errorStr += "Results of comb de-duplications are not the same!\n";
+                assert(false);
+                return false;
+            }
+
+            timeSums[i] += times[i];
+            std::cout << " " << kMethodNames[i] << ": " << times[i] << "s";
+        }
+        std::cout << std::endl;
+    }
+
+    std::cout << "Total";
+    for (std::size_t i = 0; i < kNumMethods; ++i)
+    {
+        std::cout << " " << kMethodNames[i] << ": " << timeSums[i] << "s";
+    }
+    std::cout << std::endl;
+
+    return true;
+}
+} // namespace UnitTest
 } // namespace
 
 namespace TianyuanCalc
@@ -696,7 +1499,12 @@ bool Calculator::Run(ResultDataList& resultList, std::string& errorStr, Solution
     }
     case Solution::Test:
     {
-        return true;
+#ifdef M_DEBUG
+        return UnitTest::BenchmarkCombTables(inputVec, targetVec, m_unitScale, errorStr);
+#else
+        errorStr += u8"测试模式仅供开发阶段使用\n";
+        return false;
+#endif // M_DEBUG
     }
     default:
         return false;